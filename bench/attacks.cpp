@@ -0,0 +1,105 @@
+#include <array>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <chess/chess.hpp>
+
+#include "bench.hpp"
+
+
+using namespace chess;
+
+
+static const std::vector<std::string> fens
+{
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+};
+
+
+static bitboard slider_loop_attack_set(bitboard orthogonal, bitboard diagonal, bitboard occupied)
+{
+    bitboard attacks = empty_set;
+
+    while(orthogonal)
+    {
+        square sq = set_first(orthogonal);
+        orthogonal = set_erase(orthogonal, sq);
+        attacks |= rook_attack_set(sq, occupied);
+    }
+
+    while(diagonal)
+    {
+        square sq = set_first(diagonal);
+        diagonal = set_erase(diagonal, sq);
+        attacks |= bishop_attack_set(sq, occupied);
+    }
+
+    return attacks;
+}
+
+
+int main(int argc, char* argv[])
+{
+    chess::init();
+
+    const int iterations = 1 << 14;
+
+    std::vector<board> boards;
+    std::vector<std::array<bitboard, 3>> sliders;
+
+    for(const std::string& fen: fens)
+    {
+        board b = position::from_fen(fen).get_board();
+
+        for(side s: {side_white, side_black})
+        {
+            bitboard queens = b.piece_set(piece_queen, s);
+            sliders.push_back({b.piece_set(piece_rook, s) | queens, b.piece_set(piece_bishop, s) | queens, b.occupied_set()});
+        }
+
+        boards.push_back(b);
+    }
+
+    auto run = [&](const std::string& name, auto attack_set, std::size_t count)
+    {
+        double time = measure([&]
+        {
+            bitboard acc = 0;
+            for(int i = 0; i < iterations; i++)
+            {
+                acc ^= attack_set(i % count);
+            }
+            keep(acc);
+        }) / iterations;
+
+        std::cout << std::setw(28) << name << ": " << std::fixed << std::setprecision(2) << time << " ns" << std::endl;
+    };
+
+    std::cout << "slider backend: " << to_string(get_slider_backend()) << std::endl;
+
+    run("board::attack_set", [&](std::size_t i) { return boards[i/2].attack_set(static_cast<side>(i%2)); }, boards.size()*2);
+    run("board::fill_attack_set", [&](std::size_t i) { return boards[i/2].fill_attack_set(static_cast<side>(i%2)); }, boards.size()*2);
+
+    run("sliders, per piece", [&](std::size_t i) { return slider_loop_attack_set(sliders[i][0], sliders[i][1], sliders[i][2]); }, sliders.size());
+    run("sliders, scalar fill", [&](std::size_t i) { return slider_scalar_attack_set(sliders[i][0], sliders[i][1], sliders[i][2]); }, sliders.size());
+    run("sliders, slider_attack_set", [&](std::size_t i) { return slider_attack_set(sliders[i][0], sliders[i][1], sliders[i][2]); }, sliders.size());
+
+    for(const auto& [orthogonal, diagonal, occupied]: sliders)
+    {
+        if(slider_attack_set(orthogonal, diagonal, occupied) != slider_loop_attack_set(orthogonal, diagonal, occupied)
+        || slider_scalar_attack_set(orthogonal, diagonal, occupied) != slider_loop_attack_set(orthogonal, diagonal, occupied))
+        {
+            std::cerr << "setwise and per piece attacks differ" << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
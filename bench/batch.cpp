@@ -0,0 +1,102 @@
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <chess/chess.hpp>
+
+#include "bench.hpp"
+
+
+using namespace chess;
+
+
+static void collect(position& p, int depth, std::vector<position>& positions)
+{
+    positions.push_back(p);
+
+    if(depth == 0)
+    {
+        return;
+    }
+
+    move_list moves;
+    generate(p, moves);
+
+    for(const move& m: moves)
+    {
+        undo u = p.make_move(m);
+        collect(p, depth - 1, positions);
+        p.undo_move(m, u);
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    chess::init();
+
+    std::vector<position> positions;
+
+    for(const char* fen: {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"})
+    {
+        position p = position::from_fen(fen);
+        collect(p, 2, positions);
+    }
+
+    position_batch batch;
+
+    for(const position& p: positions)
+    {
+        batch.push_back(p);
+    }
+
+    auto report = [&](const std::string& name, double time)
+    {
+        std::cout << std::setw(36) << name << ": " << std::fixed << std::setprecision(2) << time / positions.size() << " ns/position" << std::endl;
+    };
+
+    std::cout << positions.size() << " positions, " << position_batch::lanes << " per register" << std::endl;
+
+    report("generate", measure([&]
+    {
+        std::size_t total = 0;
+        for(const position& p: positions)
+        {
+            move_list moves;
+            generate(p, moves);
+            total += moves.size();
+        }
+        keep(total);
+    }));
+    report("position_batch::legal_move_counts", measure([&] { keep(batch.legal_move_counts().back()); }));
+
+    report("position::is_check", measure([&]
+    {
+        std::size_t total = 0;
+        for(const position& p: positions) total += p.is_check();
+        keep(total);
+    }));
+    report("position_batch::checks", measure([&] { keep(batch.checks().back()); }));
+
+    report("board::attack_set", measure([&]
+    {
+        bitboard total = 0;
+        for(const position& p: positions) total ^= p.get_board().attack_set(p.get_turn());
+        keep(total);
+    }));
+    report("position_batch::attack_sets", measure([&] { keep(batch.attack_sets().back()); }));
+
+    std::vector<int> counts = batch.legal_move_counts();
+
+    for(std::size_t i = 0; i < positions.size(); i++)
+    {
+        if(counts[i] != static_cast<int>(positions[i].moves().size()))
+        {
+            std::cerr << "batch and generated move counts differ: " << positions[i].to_fen() << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,130 @@
+#ifndef CHESS_BENCH_HPP
+#define CHESS_BENCH_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+
+/// Prevent the compiler from optimizing away a value.
+template<typename T>
+inline void keep(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+
+/// Timing statistics.
+///
+/// Times of a number of runs, in nanoseconds.
+struct statistics
+{
+    double median;
+    double mean;
+    double deviation;
+    double minimum;
+    double maximum;
+    int runs;
+
+    /// Half width of the 95 % confidence interval of the mean.
+    double error() const
+    {
+        return 1.96 * deviation / std::sqrt(runs);
+    }
+
+    /// Statistics of one of n operations done in each run.
+    statistics per(double n) const
+    {
+        return {median / n, mean / n, deviation / n, minimum / n, maximum / n, runs};
+    }
+};
+
+
+/// Sample function.
+///
+/// Runs the function a number of times, after a few untimed warmup runs that
+/// fill caches and settle the clock frequency, and returns statistics of the
+/// times of the timed runs.
+///
+/// \param f The function.
+/// \param runs Number of timed runs.
+/// \param warmup Number of untimed runs.
+/// \returns Statistics of the time of a run.
+template<typename F>
+statistics sample(F&& f, int runs = 31, int warmup = 3)
+{
+    for(int i = 0; i < warmup; i++)
+    {
+        f();
+    }
+
+    std::vector<double> times;
+
+    for(int i = 0; i < runs; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+    }
+
+    std::sort(times.begin(), times.end());
+
+    double sum = 0.0;
+    for(double t: times) sum += t;
+    double mean = sum / runs;
+
+    double squares = 0.0;
+    for(double t: times) squares += (t - mean) * (t - mean);
+    double deviation = runs > 1 ? std::sqrt(squares / (runs - 1)) : 0.0;
+
+    return {times[runs/2], mean, deviation, times.front(), times.back(), runs};
+}
+
+
+/// Time function.
+///
+/// Runs the function a number of times and returns the median time of one
+/// run, which is less sensitive to interruptions than the mean.
+///
+/// \param f The function.
+/// \param runs Number of runs.
+/// \returns Median time of a run in nanoseconds.
+template<typename F>
+double measure(F&& f, int runs = 15)
+{
+    return sample(f, runs, 0).median;
+}
+
+
+/// Random occupancies.
+///
+/// Sparse occupancies, similar to the ones found in games.
+///
+/// \param n Number of occupancies.
+/// \returns The occupancies.
+inline std::vector<std::uint64_t> occupancies(std::size_t n)
+{
+    std::vector<std::uint64_t> occ(n);
+    std::uint64_t x = 0x9e3779b97f4a7c15ULL;
+
+    auto next = [&x]
+    {
+        x ^= x >> 12;
+        x ^= x << 25;
+        x ^= x >> 27;
+        return x * 0x2545f4914f6cdd1dULL;
+    };
+
+    for(std::uint64_t& o: occ)
+    {
+        o = next() & next() & next();
+    }
+
+    return occ;
+}
+
+
+#endif
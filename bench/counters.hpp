@@ -0,0 +1,264 @@
+#ifndef CHESS_COUNTERS_HPP
+#define CHESS_COUNTERS_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <ios>
+#include <ostream>
+#include <string>
+
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+/// Hardware performance counters.
+///
+/// Counts cycles, instructions, branch misses and cache and TLB misses of the
+/// calling thread, and of threads it creates while counting, with Linux
+/// perf_event_open. Each counter is opened on its own, so a host that lacks
+/// some of them (as virtual machines often do) still reports the rest, and a
+/// host that does not permit counting at all reports nothing but the reason.
+class counters
+{
+public:
+    enum event
+    {
+        event_cycles,
+        event_instructions,
+        event_branch_misses,
+        event_l1d_misses,
+        event_llc_misses,
+        event_dtlb_misses,
+        events,
+    };
+
+    counters()
+    {
+        fds.fill(-1);
+        values.fill(0);
+        run_values.fill(0);
+
+#ifdef __linux__
+        const std::uint32_t types[events] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE};
+        const std::uint64_t configs[events] =
+        {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_BRANCH_MISSES,
+            cache_config(PERF_COUNT_HW_CACHE_L1D),
+            cache_config(PERF_COUNT_HW_CACHE_LL),
+            cache_config(PERF_COUNT_HW_CACHE_DTLB),
+        };
+
+        for(int e = 0; e < events; e++)
+        {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = types[e];
+            attr.config = configs[e];
+            attr.disabled = 1;
+            attr.inherit = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            fds[e] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+            if(fds[e] < 0 && error.empty()) error = std::strerror(errno);
+        }
+#else
+        error = "not supported on this platform";
+#endif
+    }
+
+    ~counters()
+    {
+#ifdef __linux__
+        for(int fd: fds) if(fd >= 0) close(fd);
+#endif
+    }
+
+    counters(const counters&) = delete;
+    counters& operator=(const counters&) = delete;
+
+    /// Whether any counter could be opened.
+    bool available() const
+    {
+        for(int fd: fds) if(fd >= 0) return true;
+        return false;
+    }
+
+    /// Start counting.
+    void start()
+    {
+#ifdef __linux__
+        for(int fd: fds)
+        {
+            if(fd < 0) continue;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    /// Stop counting.
+    ///
+    /// Keeps the counts since start() as the counts of the run, and adds them
+    /// to the totals. Counts are scaled up if the kernel multiplexed the
+    /// counters.
+    void stop()
+    {
+        run_values.fill(0);
+
+#ifdef __linux__
+        for(int e = 0; e < events; e++)
+        {
+            if(fds[e] < 0) continue;
+
+            ioctl(fds[e], PERF_EVENT_IOC_DISABLE, 0);
+
+            std::uint64_t data[3] = {0, 0, 0};
+            if(read(fds[e], data, sizeof(data)) != sizeof(data)) continue;
+
+            run_values[e] = data[2] ? static_cast<std::uint64_t>(static_cast<double>(data[0]) * data[1] / data[2]) : 0;
+            values[e] += run_values[e];
+        }
+#endif
+    }
+
+    /// Reset the totals.
+    void clear()
+    {
+        values.fill(0);
+        run_values.fill(0);
+    }
+
+    /// Whether an event is counted.
+    bool has(event e) const
+    {
+        return fds[e] >= 0;
+    }
+
+    /// Total count of an event.
+    std::uint64_t get(event e) const
+    {
+        return values[e];
+    }
+
+    /// Count of an event in the last run, from start() to stop().
+    std::uint64_t get_run(event e) const
+    {
+        return run_values[e];
+    }
+
+    /// Name of an event.
+    static const char* name(event e)
+    {
+        const char* names[events] = {"cycles", "instructions", "branch misses", "l1d misses", "llc misses", "dtlb misses"};
+        return names[e];
+    }
+
+    /// Write the counts of the last run on one line.
+    ///
+    /// Writes nothing if no counter is available, report() tells why.
+    ///
+    /// \param out The stream.
+    /// \param nodes Nodes counted in the run, counts are given per million nodes.
+    void report_run(std::ostream& out, unsigned long long nodes) const
+    {
+        if(!available() || !nodes) return;
+
+        double mnodes = nodes / 1e6;
+
+        std::ios_base::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+
+        out << "  per Mnode:" << std::fixed << std::setprecision(0);
+        const char* separator = " ";
+
+        for(int e = 0; e < events; e++)
+        {
+            if(!has(static_cast<event>(e))) continue;
+
+            out << separator << name(static_cast<event>(e)) << " " << run_values[e] / mnodes;
+            separator = ", ";
+        }
+
+        if(has(event_cycles) && has(event_instructions) && run_values[event_cycles])
+        {
+            out << separator << "ipc " << std::setprecision(2) << static_cast<double>(run_values[event_instructions]) / run_values[event_cycles];
+        }
+
+        out << std::endl;
+
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+    /// Write the total counts.
+    ///
+    /// \param out The stream.
+    /// \param nodes Nodes counted, counts are also given per million nodes.
+    void report(std::ostream& out, unsigned long long nodes) const
+    {
+        if(!available())
+        {
+            out << "counters: unavailable (" << error << ")" << std::endl;
+            return;
+        }
+
+        double mnodes = nodes / 1e6;
+
+        std::ios_base::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+
+        for(int e = 0; e < events; e++)
+        {
+            out << std::left << std::setw(14) << (std::string(name(static_cast<event>(e))) + ":") << std::right;
+
+            if(has(static_cast<event>(e)))
+            {
+                out << std::setw(16) << values[e];
+                if(mnodes > 0.0) out << " (" << std::fixed << std::setprecision(0) << values[e] / mnodes << " per Mnode)";
+            }
+            else
+            {
+                out << std::setw(16) << "-";
+            }
+
+            out << std::endl;
+        }
+
+        if(has(event_cycles) && has(event_instructions) && values[event_cycles])
+        {
+            out << std::left << std::setw(14) << "ipc:" << std::right << std::setw(16) << std::fixed << std::setprecision(2)
+                << static_cast<double>(values[event_instructions]) / values[event_cycles] << std::endl;
+        }
+
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+private:
+#ifdef __linux__
+    static constexpr std::uint64_t cache_config(std::uint64_t cache)
+    {
+        return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+#endif
+
+    std::array<int, events> fds;
+    std::array<std::uint64_t, events> values;
+    std::array<std::uint64_t, events> run_values;
+    std::string error;
+};
+
+
+#endif
@@ -0,0 +1,195 @@
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include <chess/chess.hpp>
+
+#include "bench.hpp"
+
+
+using namespace chess;
+
+
+// Positions of games played with pseudo-random moves from a few openings and
+// middlegames. The generator is seeded with a constant, so the corpus is the
+// same in every run.
+struct corpus
+{
+    std::vector<position> positions;
+    std::vector<std::string> fens;
+    std::vector<move> line;
+};
+
+static corpus make_corpus(std::size_t n)
+{
+    const std::string_view starts[] =
+    {
+        position::fen_start,
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    };
+
+    corpus c;
+    std::uint64_t x = 0x9e3779b97f4a7c15ULL;
+
+    auto next = [&x]
+    {
+        x ^= x >> 12;
+        x ^= x << 25;
+        x ^= x >> 27;
+        return x * 0x2545f4914f6cdd1dULL;
+    };
+
+    for(std::size_t game = 0; c.positions.size() < n; game++)
+    {
+        position p = position::from_fen(starts[game % std::size(starts)]);
+
+        for(int ply = 0; ply < 80 && c.positions.size() < n; ply++)
+        {
+            move_list moves;
+            generate(p, moves);
+            if(moves.empty()) break;
+
+            c.positions.push_back(p);
+            c.fens.push_back(p.to_fen());
+
+            move m = moves[next() % moves.size()];
+            if(game == 0) c.line.push_back(m);
+            p.make_move(m);
+        }
+    }
+
+    return c;
+}
+
+
+static void report(const std::string& name, const statistics& s)
+{
+    std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(10) << s.median << " ns"
+              << std::setw(10) << s.mean << " ± " << std::setw(6) << s.error() << " ns"
+              << std::setw(10) << s.minimum << " ns" << std::endl;
+}
+
+
+int main(int argc, char* argv[])
+{
+    chess::init();
+
+    const std::size_t n = 1024;
+    corpus c = make_corpus(n);
+
+    std::vector<move_list> moves(n);
+    std::size_t move_count = 0;
+
+    for(std::size_t i = 0; i < n; i++)
+    {
+        generate(c.positions[i], moves[i]);
+        move_count += moves[i].size();
+    }
+
+    std::cout << "corpus: " << n << " positions, " << move_count << " moves, slider backend " << to_string(get_slider_backend()) << std::endl;
+    std::cout << std::left << std::setw(28) << "primitive" << std::right
+              << std::setw(13) << "median" << std::setw(22) << "mean (95 %)" << std::setw(13) << "minimum" << std::endl;
+
+    report("position::moves", sample([&]
+    {
+        for(const position& p: c.positions) keep(p.moves().size());
+    }).per(n));
+
+    report("generate", sample([&]
+    {
+        for(const position& p: c.positions)
+        {
+            move_list list;
+            generate(p, list);
+            keep(list.size());
+        }
+    }).per(n));
+
+    report("make_move/undo_move", sample([&]
+    {
+        for(std::size_t i = 0; i < n; i++)
+        {
+            position& p = c.positions[i];
+            for(const move& m: moves[i])
+            {
+                undo u = p.make_move(m);
+                keep(p.hash());
+                p.undo_move(m, u);
+            }
+        }
+    }).per(move_count));
+
+    report("copy_move", sample([&]
+    {
+        for(std::size_t i = 0; i < n; i++)
+        {
+            for(const move& m: moves[i]) keep(c.positions[i].copy_move(m).hash());
+        }
+    }).per(move_count));
+
+    report("board::attack_set", sample([&]
+    {
+        for(const position& p: c.positions) keep(p.get_board().attack_set(p.get_turn()));
+    }).per(n));
+
+    report("rook_attack_set", sample([&]
+    {
+        bitboard acc = 0;
+        for(std::size_t i = 0; i < n; i++) acc ^= rook_attack_set(static_cast<square>(i & 63), c.positions[i].get_board().occupied_set());
+        keep(acc);
+    }).per(n));
+
+    report("bishop_attack_set", sample([&]
+    {
+        bitboard acc = 0;
+        for(std::size_t i = 0; i < n; i++) acc ^= bishop_attack_set(static_cast<square>(i & 63), c.positions[i].get_board().occupied_set());
+        keep(acc);
+    }).per(n));
+
+    const direction shifts[] = {direction_n, direction_ne, direction_e, direction_se, direction_s, direction_sw, direction_w, direction_nw};
+
+    report("set_shift", sample([&]
+    {
+        bitboard acc = 0;
+        for(std::size_t i = 0; i < n; i++) acc ^= set_shift(c.positions[i].get_board().occupied_set(), shifts[i % std::size(shifts)]);
+        keep(acc);
+    }).per(n));
+
+    report("set_shift<d>", sample([&]
+    {
+        bitboard acc = 0;
+        for(std::size_t i = 0; i < n; i++) acc ^= set_shift<direction_ne>(c.positions[i].get_board().occupied_set());
+        keep(acc);
+    }).per(n));
+
+    report("position::hash", sample([&]
+    {
+        std::size_t acc = 0;
+        for(const position& p: c.positions) acc ^= p.hash();
+        keep(acc);
+    }).per(n));
+
+    report("position::from_fen", sample([&]
+    {
+        for(const std::string& fen: c.fens) keep(position::from_fen(fen).hash());
+    }).per(n));
+
+    report("position::to_fen", sample([&]
+    {
+        for(const position& p: c.positions) keep(p.to_fen().size());
+    }).per(n));
+
+    report("game::push/pop", sample([&]
+    {
+        game g;
+        for(const move& m: c.line) g.push(m);
+        while(!g.empty()) g.pop();
+        keep(g.size());
+    }).per(c.line.size()));
+
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <chess/chess.hpp>
+
+#include "counters.hpp"
+
+
+using namespace chess;
+
+
+// Fixed workload, the node count of every entry is part of the signature.
+struct workload
+{
+    std::string_view fen;
+    int depth;
+};
+
+static const workload perft_workload[] =
+{
+    {position::fen_start, 6},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 5},
+    {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 6},
+    {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 5},
+    {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 5},
+    {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 5},
+};
+
+
+// Perft without a hash table, so that every node is visited in every run.
+static unsigned long long perft(int depth, position& p)
+{
+    if(depth == 0) return 1;
+    if(depth == 1) return p.count_legal_moves();
+
+    move_list moves;
+    generate(p, moves);
+
+    unsigned long long nodes = 0;
+
+    for(const move& m: moves)
+    {
+        undo u = p.make_move(m);
+        nodes += perft(depth - 1, p);
+        p.undo_move(m, u);
+    }
+
+    return nodes;
+}
+
+
+// Deterministic benchmark.
+//
+// Runs a fixed workload and prints the total number of nodes, which only
+// changes when the behaviour of the library changes, and the number of nodes
+// per second, which is what to compare between builds and hosts. With
+// --counters, hardware events of each entry and of the whole workload are
+// also reported.
+int main(int argc, char* argv[])
+{
+    chess::init();
+
+    // the counters are only opened when asked for
+    std::optional<counters> events;
+    if(argc > 1 && std::string(argv[1]) == "--counters") events.emplace();
+
+    unsigned long long signature = 0;
+    double total = 0.0;
+
+    for(const workload& w: perft_workload)
+    {
+        position p = position::from_fen(w.fen);
+
+        if(events) events->start();
+        auto begin = std::chrono::steady_clock::now();
+        unsigned long long nodes = perft(w.depth, p);
+        std::chrono::duration<double> time = std::chrono::steady_clock::now() - begin;
+        if(events) events->stop();
+
+        signature += nodes;
+        total += time.count();
+
+        std::cerr << "perft " << w.depth << " '" << w.fen << "': " << nodes << " nodes, " << std::fixed << std::setprecision(3) << time.count() << " s" << std::endl;
+        if(events) events->report_run(std::cerr, nodes);
+    }
+
+    std::cout << "nodes: " << signature << std::endl;
+    std::cout << "time: " << std::fixed << std::setprecision(3) << total << " s" << std::endl;
+    std::cout << "nps: " << static_cast<unsigned long long>(signature / total) << std::endl;
+
+    if(events) events->report(std::cout, signature);
+
+    return 0;
+}
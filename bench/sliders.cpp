@@ -0,0 +1,56 @@
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include <chess/chess.hpp>
+
+#include "bench.hpp"
+
+
+using namespace chess;
+
+
+int main(int argc, char* argv[])
+{
+    chess::init();
+
+    const std::size_t n = 1 << 16;
+    std::vector<bitboard> occ = occupancies(n);
+    slider_backend selected = get_slider_backend();
+
+    std::cout << "default backend: " << to_string(selected) << std::endl;
+
+    for(slider_backend b: {slider_magic, slider_pext, slider_compact})
+    {
+        if(!set_slider_backend(b))
+        {
+            std::cout << std::setw(8) << to_string(b) << ": unsupported" << std::endl;
+            continue;
+        }
+
+        auto run = [&](auto attack_set)
+        {
+            return measure([&]
+            {
+                bitboard acc = 0;
+                for(std::size_t i = 0; i < n; i++)
+                {
+                    acc ^= attack_set(static_cast<square>(i & 63), occ[i]);
+                }
+                keep(acc);
+            }) / n;
+        };
+
+        double rook = run(rook_attack_set);
+        double bishop = run(bishop_attack_set);
+
+        std::cout << std::setw(8) << to_string(b) << ": "
+                  << std::fixed << std::setprecision(2)
+                  << "rook " << rook << " ns, "
+                  << "bishop " << bishop << " ns" << std::endl;
+    }
+
+    set_slider_backend(selected);
+
+    return 0;
+}
@@ -5,10 +5,15 @@
 #include <array>
 #include <bit>
 #include <cstdint>
+#include <string>
 #include <vector>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CHESS_X86
+#endif
+
 #include "direction.hpp"
-#include "random.hpp"
 #include "square.hpp"
 #include "set.hpp"
 #include "attack.hpp"
@@ -22,181 +27,443 @@ struct magic
 {
     bitboard mask;
     bitboard magic;
-    bitboard* attacks;
+    unsigned offset;
     unsigned shift;
 };
 
 
-inline unsigned magic_index(const magic& m, bitboard occupied)
+constexpr unsigned magic_index(const magic& m, bitboard occupied)
 {
-    return ((occupied & m.mask) * m.magic) >> m.shift;
+    return m.offset + (((occupied & m.mask) * m.magic) >> m.shift);
 }
 
 
-static std::array<magic, squares> rook_magics;
-static std::array<magic, squares> bishop_magics;
-static std::array<bitboard, 0x19000> rook_attack_table;
-static std::array<bitboard, squares> knight_attack_table;
-static std::array<bitboard, 0x1480> bishop_attack_table;
-static std::array<bitboard, squares> king_attack_table;
+template<std::size_t size>
+struct magic_table
+{
+    std::array<magic, squares> magics;
+    std::array<bitboard, size> attacks;
+};
+
+
+// Magic numbers for a fixed shift of 64 minus the number of relevant occupancy
+// bits. Any numbers that map all occupancies of a square to correct attacks
+// work, these were found by trial and error.
+static constexpr std::array<bitboard, squares> rook_magic_numbers
+{
+    0x5180003860804004ULL, 0x0440004010002000ULL, 0x07003008c0200100ULL, 0x1600120004204008ULL,
+    0x038022802c000800ULL, 0x0200040801900200ULL, 0xc480110000800200ULL, 0x4100021040208100ULL,
+    0x0810800040008025ULL, 0x2100402000401004ULL, 0x3022001200208044ULL, 0x280300201003002aULL,
+    0x8001000500080010ULL, 0x0241000208840100ULL, 0x0411000419004200ULL, 0x4020800071000080ULL,
+    0x0041020022008040ULL, 0x0020008020804000ULL, 0x0010002008002400ULL, 0x3104a50010010008ULL,
+    0x0000050008005100ULL, 0x0001010008020400ULL, 0x8000808001000200ULL, 0x1000020000804401ULL,
+    0x2800401480002080ULL, 0x6010045a40002000ULL, 0x0410080020002401ULL, 0x1068008080081000ULL,
+    0x4900080080800400ULL, 0x0900040080800200ULL, 0x4a28088400620110ULL, 0x0104110200104094ULL,
+    0x0140204010800083ULL, 0x4080402001401008ULL, 0x0800102001004100ULL, 0x4000080080801000ULL,
+    0x0080800800800400ULL, 0x0004020080800400ULL, 0x0000080104001082ULL, 0x0001804102000084ULL,
+    0x00008000c0028021ULL, 0x0680201000404000ULL, 0x0320008010008020ULL, 0x01001001008b0020ULL,
+    0x4082006024320009ULL, 0x1006020004008080ULL, 0x4880904802040001ULL, 0x0080304081020004ULL,
+    0x01448a09e0410200ULL, 0x2044401004200540ULL, 0x0a00100020008080ULL, 0x1414100080080080ULL,
+    0x0000080004008080ULL, 0x0042001004080200ULL, 0x0011000200040100ULL, 0x101000441100a200ULL,
+    0x0009402195008001ULL, 0x4081002040001081ULL, 0x80000a0080201042ULL, 0x400406000e20400aULL,
+    0x4011000250080005ULL, 0x2201000804000201ULL, 0x244021301200a804ULL, 0x0808002049008402ULL
+};
+
+static constexpr std::array<bitboard, squares> bishop_magic_numbers
+{
+    0x0040020220410108ULL, 0x00820806328a0214ULL, 0x1484010202044040ULL, 0x1008204040006400ULL,
+    0x0801104001443000ULL, 0x9842020220002120ULL, 0x880c020104202002ULL, 0x0082490808020210ULL,
+    0x01000823101a0201ULL, 0x041005010c041080ULL, 0x4001410242004000ULL, 0x8801082040400102ULL,
+    0x1000040420210080ULL, 0x0000084402600020ULL, 0x2806060210048420ULL, 0x200800c212192041ULL,
+    0x0210022020810152ULL, 0x0020001001810900ULL, 0x0002104448010100ULL, 0x2004021090220002ULL,
+    0x1001000811400040ULL, 0x4002020941100104ULL, 0x09220014420a2100ULL, 0x0000802900411080ULL,
+    0x044220c208200400ULL, 0x2001140808101c21ULL, 0x0000500018008410ULL, 0x206c04002800a088ULL,
+    0x2005020144008400ULL, 0x1001060004405000ULL, 0x0042454102080640ULL, 0x8000808a0200440aULL,
+    0x0c30aa3080081000ULL, 0x01c4410440204410ULL, 0x0000140200100080ULL, 0x4004400808008200ULL,
+    0x0001210401020020ULL, 0x1810100040102400ULL, 0x0508009080090850ULL, 0x2402021820020085ULL,
+    0x2404040288804019ULL, 0x000400a248331044ULL, 0x0802002038003404ULL, 0x1020012018000d00ULL,
+    0x5012080104008044ULL, 0x0010a11008205100ULL, 0x8108100400800046ULL, 0x0204008089100200ULL,
+    0x00010082b0402080ULL, 0x8000440201100000ULL, 0x0030aa0100c81000ULL, 0x0042900708580000ULL,
+    0x0080200410440802ULL, 0x0010105001084020ULL, 0x4064102c48048421ULL, 0xa008284080820140ULL,
+    0x4022410068200402ULL, 0x2000011482100248ULL, 0x2812006224022800ULL, 0x0000800040420200ULL,
+    0x4802001011020202ULL, 0x10a0000803080208ULL, 0x2009101081410400ULL, 0x30820202480e0481ULL
+};
 
 
-bitboard pawn_east_attack_set(bitboard bb, side s)
+// Attacks along a line (not including the square) by obstruction difference.
+// The nearest blocker below the square and the nearest blocker above it bound
+// the attacks, and their difference sets every bit in between.
+static constexpr bitboard line_attack_set(square sq, bitboard line, bitboard occupied)
 {
-    return set_shift(bb, static_cast<direction>(forwards(s) + direction_e));
+    bitboard below = square_set(sq) - 1;
+    bitboard lower = line & below & occupied;
+    bitboard upper = line & ~below & occupied;
+    bitboard lower_bound = universal_set << (square_h8 - std::countl_zero(lower | 1));
+    bitboard upper_bound = upper & -upper;
+    return line & (2*upper_bound + lower_bound);
 }
 
 
-bitboard pawn_west_attack_set(bitboard bb, side s)
+static constexpr bitboard rook_compact_attack_set(square sq, bitboard occupied)
 {
-    return set_shift(bb, static_cast<direction>(forwards(s) + direction_w));
+    bitboard sq_bb = square_set(sq);
+    return line_attack_set(sq, file_set(file_of(sq)) ^ sq_bb, occupied)
+         | line_attack_set(sq, rank_set(rank_of(sq)) ^ sq_bb, occupied);
 }
 
 
-bitboard rook_attack_set(square sq, bitboard occupied)
+static constexpr bitboard bishop_compact_attack_set(square sq, bitboard occupied)
 {
-    unsigned index = magic_index(rook_magics[sq], occupied);
-    return rook_magics[sq].attacks[index];
+    bitboard sq_bb = square_set(sq);
+    return line_attack_set(sq, diagonal_set(sq) ^ sq_bb, occupied)
+         | line_attack_set(sq, antidiagonal_set(sq) ^ sq_bb, occupied);
 }
 
 
-bitboard knight_attack_set(square sq)
+template<std::size_t size>
+static constexpr magic_table<size> ray_table_init(const std::array<bitboard, squares>& magic_numbers, bitboard (*attack_set)(square, bitboard))
 {
-    return knight_attack_table[sq];
+    magic_table<size> table{};
+    unsigned offset = 0;
+
+    for(int i = square_a1; i <= square_h8; i++)
+    {
+        square sq = static_cast<square>(i);
+        magic& m = table.magics[sq];
+
+        bitboard edges = ((rank_set(rank_1) | rank_set(rank_8)) & ~rank_set(rank_of(sq)))
+                       | ((file_set(file_a) | file_set(file_h)) & ~file_set(file_of(sq)));
+
+        m.mask = attack_set(sq, empty_set) & ~edges;
+        m.magic = magic_numbers[sq];
+        m.offset = offset;
+        m.shift = squares - std::popcount(m.mask);
+
+        // enumerate all subsets of the relevant occupancy
+        bitboard bb = 0;
+
+        do
+        {
+            bitboard& entry = table.attacks[magic_index(m, bb)];
+
+            // slider attacks are never empty, so a set entry with other attacks
+            // means that the magic number is wrong, which stops compilation
+            if(entry && entry != attack_set(sq, bb))
+            {
+                throw "magic number maps occupancies to the same index";
+            }
+
+            entry = attack_set(sq, bb);
+            bb = (bb - m.mask) & m.mask;
+        } while(bb);
+
+        offset += 1U << std::popcount(m.mask);
+    }
+
+    return table;
 }
 
 
-bitboard bishop_attack_set(square sq, bitboard occupied)
+static constexpr magic_table<0x19000> rook_table = ray_table_init<0x19000>(rook_magic_numbers, rook_compact_attack_set);
+static constexpr magic_table<0x1480> bishop_table = ray_table_init<0x1480>(bishop_magic_numbers, bishop_compact_attack_set);
+
+attack_tables attack_table;
+
+static bool slider_fill_avx2 = false;
+static std::array<slider_lookup, squares> rook_pexts;
+static std::array<slider_lookup, squares> bishop_pexts;
+static std::array<bitboard, 0x19000> rook_pext_table;
+static std::array<bitboard, 0x1480> bishop_pext_table;
+
+
+static bitboard rook_magic_attack_set(square sq, bitboard occupied)
 {
-    unsigned index = magic_index(bishop_magics[sq], occupied);
-    return bishop_magics[sq].attacks[index];
+    return rook_table.attacks[magic_index(rook_table.magics[sq], occupied)];
 }
 
 
-bitboard queen_attack_set(square sq, bitboard occupied)
+static bitboard bishop_magic_attack_set(square sq, bitboard occupied)
 {
-    return rook_attack_set(sq, occupied) | bishop_attack_set(sq, occupied);
+    return bishop_table.attacks[magic_index(bishop_table.magics[sq], occupied)];
 }
 
 
-bitboard king_attack_set(square sq)
+#ifdef CHESS_X86
+__attribute__((target("bmi2")))
+static bitboard rook_pext_attack_set(square sq, bitboard occupied)
 {
-    return king_attack_table[sq];
+    return rook_pexts[sq].attacks[_pext_u64(occupied, rook_pexts[sq].mask)];
 }
 
 
+__attribute__((target("bmi2")))
+static bitboard bishop_pext_attack_set(square sq, bitboard occupied)
+{
+    return bishop_pexts[sq].attacks[_pext_u64(occupied, bishop_pexts[sq].mask)];
+}
+#endif
+
 
-static void shift_table_init(bitboard* attacks, const std::array<direction, 8>& directions)
+bitboard rook_backend_attack_set(square sq, bitboard occupied)
 {
-    for(int i = square_a1; i <= square_h8; i++)
+    switch(attack_table.backend())
     {
-        square sq = static_cast<square>(i);
+#ifdef CHESS_X86
+    case slider_pext:
+        return rook_pext_attack_set(sq, occupied);
+#endif
+    case slider_compact:
+        return rook_compact_attack_set(sq, occupied);
+    case slider_magic:
+    default:
+        return rook_magic_attack_set(sq, occupied);
+    }
+}
 
-        bitboard sq_bb = square_set(sq);
-
-        // initialize knight attacks table
-        attacks[sq] = set_shift(sq_bb, directions[0])
-                    | set_shift(sq_bb, directions[1])
-                    | set_shift(sq_bb, directions[2])
-                    | set_shift(sq_bb, directions[3])
-                    | set_shift(sq_bb, directions[4])
-                    | set_shift(sq_bb, directions[5])
-                    | set_shift(sq_bb, directions[6])
-                    | set_shift(sq_bb, directions[7]);
+
+bitboard bishop_backend_attack_set(square sq, bitboard occupied)
+{
+    switch(attack_table.backend())
+    {
+#ifdef CHESS_X86
+    case slider_pext:
+        return bishop_pext_attack_set(sq, occupied);
+#endif
+    case slider_compact:
+        return bishop_compact_attack_set(sq, occupied);
+    case slider_magic:
+    default:
+        return bishop_magic_attack_set(sq, occupied);
     }
 }
 
 
-static void ray_table_init(bitboard* attacks, std::array<magic, squares>& magics, const std::array<direction, 4>& directions, random& rng)
+#ifdef CHESS_X86
+template<bool left>
+__attribute__((target("avx2")))
+static inline __m256i lane_shift(__m256i x, __m256i n)
+{
+    return left ? _mm256_sllv_epi64(x, n) : _mm256_srlv_epi64(x, n);
+}
+
+
+// Left shifts fill north, east, northeast and northwest in the four lanes,
+// right shifts fill south, west, southwest and southeast.
+template<bool left>
+__attribute__((target("avx2")))
+static inline __m256i slider_fill(__m256i gen, __m256i empty, __m256i shift, __m256i trim)
+{
+    __m256i pro = _mm256_andnot_si256(trim, empty);
+    __m256i shift2 = _mm256_add_epi64(shift, shift);
+    __m256i shift4 = _mm256_add_epi64(shift2, shift2);
+
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, lane_shift<left>(gen, shift)));
+    pro = _mm256_and_si256(pro, lane_shift<left>(pro, shift));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, lane_shift<left>(gen, shift2)));
+    pro = _mm256_and_si256(pro, lane_shift<left>(pro, shift2));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, lane_shift<left>(gen, shift4)));
+
+    return _mm256_andnot_si256(trim, lane_shift<left>(gen, shift));
+}
+
+
+__attribute__((target("avx2")))
+static bitboard slider_avx2_attack_set(bitboard orthogonal, bitboard diagonal, bitboard occupied)
+{
+    const __m256i shift = _mm256_setr_epi64x(direction_n, direction_e, direction_ne, direction_nw);
+    const __m256i left_trim = _mm256_setr_epi64x(shift_trim(direction_n), shift_trim(direction_e), shift_trim(direction_ne), shift_trim(direction_nw));
+    const __m256i right_trim = _mm256_setr_epi64x(shift_trim(direction_s), shift_trim(direction_w), shift_trim(direction_sw), shift_trim(direction_se));
+
+    __m256i gen = _mm256_setr_epi64x(orthogonal, orthogonal, diagonal, diagonal);
+    __m256i empty = _mm256_set1_epi64x(~occupied);
+
+    __m256i attacks = _mm256_or_si256(slider_fill<true>(gen, empty, shift, left_trim), slider_fill<false>(gen, empty, shift, right_trim));
+    __m128i halves = _mm_or_si128(_mm256_castsi256_si128(attacks), _mm256_extracti128_si256(attacks, 1));
+
+    return _mm_cvtsi128_si64(halves) | _mm_extract_epi64(halves, 1);
+}
+#endif
+
+
+bitboard slider_attack_set(bitboard orthogonal, bitboard diagonal, bitboard occupied)
 {
-    bitboard occupancy[4096];
-    bitboard reference[4096];
-    int epoch[4096] = {0};
-    int count = 0;
-    int size = 0;
+#ifdef CHESS_X86
+    if(slider_fill_avx2)
+    {
+        return slider_avx2_attack_set(orthogonal, diagonal, occupied);
+    }
+#endif
+    return slider_scalar_attack_set(orthogonal, diagonal, occupied);
+}
+
 
+#ifdef CHESS_X86
+template<std::size_t size>
+__attribute__((target("bmi2")))
+static void pext_table_init(bitboard* attacks, std::array<slider_lookup, squares>& pexts, const magic_table<size>& table)
+{
     for(int i = square_a1; i <= square_h8; i++)
     {
         square sq = static_cast<square>(i);
+        const magic& m = table.magics[sq];
 
-        bitboard sq_bb = square_set(sq);
-        bitboard edges = ((rank_set(rank_1) | rank_set(rank_8)) & ~rank_set(rank_of(sq)))
-                       | ((file_set(file_a) | file_set(file_h)) & ~file_set(file_of(sq)));
+        // same relevant occupancy as the magics, but indexed by extracting its bits
+        pexts[sq] = {m.mask, 0, attacks, 0};
 
-        magics[sq].mask = set_ray(sq_bb, directions[0], empty_set)
-                        | set_ray(sq_bb, directions[1], empty_set)
-                        | set_ray(sq_bb, directions[2], empty_set)
-                        | set_ray(sq_bb, directions[3], empty_set);
-        magics[sq].mask &= ~edges;
+        bitboard bb = 0;
 
-        magics[sq].shift = squares - set_cardinality(magics[sq].mask);
+        do
+        {
+            attacks[_pext_u64(bb, m.mask)] = table.attacks[magic_index(m, bb)];
+            bb = (bb - m.mask) & m.mask;
+        } while(bb);
 
-        // attack table of this square continues from the end of the last table
-        magics[sq].attacks = sq == square_a1 ? attacks : magics[sq - 1].attacks + size;
+        attacks += 1ULL << set_cardinality(m.mask);
+    }
+}
+#endif
 
-        bitboard bb = 0;
-        size = 0;
 
-        // store all relevant occupancies and their corresponding attack table entry
-        do
+bool slider_backend_supported(slider_backend b)
+{
+    switch(b)
+    {
+    case slider_pext:
+#ifdef CHESS_X86
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("bmi2");
+#else
+        return false;
+#endif
+    case slider_magic:
+    case slider_compact:
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+bool set_slider_backend(slider_backend b)
+{
+    if(!slider_backend_supported(b))
+    {
+        return false;
+    }
+
+    attack_table.active_backend = b;
+
+    // the compact backend has no tables, and is never looked up inline
+    for(int i = square_a1; i <= square_h8; i++)
+    {
+        const magic& rook = rook_table.magics[i];
+        const magic& bishop = bishop_table.magics[i];
+
+        attack_table.rook_lookups[i] = {rook.mask, rook.magic, &rook_table.attacks[rook.offset], rook.shift};
+        attack_table.bishop_lookups[i] = {bishop.mask, bishop.magic, &bishop_table.attacks[bishop.offset], bishop.shift};
+
+        if(b == slider_pext)
         {
-            // bitboard never becomes zero...
-            occupancy[size] = bb;
-            // actual attacks
-            reference[size] = set_ray(sq_bb, directions[0], bb)
-                            | set_ray(sq_bb, directions[1], bb)
-                            | set_ray(sq_bb, directions[2], bb)
-                            | set_ray(sq_bb, directions[3], bb);
-
-            size++;
-            bb = (bb - magics[sq].mask) & magics[sq].mask;
-        } while (bb);
-        
-        // initialize pseudo-random number generator
-        //int seed = magic_seeds[square_rank(sq)];
-        //random r;
-        //random_init(&r, seed);
-
-        // randomize until magic number that works is found
-        int j = 0;
-        while(j < size)
+            attack_table.rook_lookups[i] = rook_pexts[i];
+            attack_table.bishop_lookups[i] = bishop_pexts[i];
+        }
+    }
+
+    return true;
+}
+
+
+slider_backend get_slider_backend()
+{
+    return attack_table.backend();
+}
+
+
+std::string to_string(slider_backend b)
+{
+    switch(b)
+    {
+    case slider_magic:      return "magic";
+    case slider_pext:       return "pext";
+    case slider_compact:    return "compact";
+    default:                break;
+    }
+
+    return "none";
+}
+
+
+static slider_backend default_slider_backend()
+{
+#ifdef CHESS_SLIDER_BACKEND
+    // an override the host does not support falls back to magic
+    return slider_backend_supported(CHESS_SLIDER_BACKEND) ? CHESS_SLIDER_BACKEND : slider_magic;
+#else
+#ifdef __BMI2__
+    // pext is microcoded, and slower than magic lookups, on amd before zen 3.
+    // Without BMI2 at build time pext can not be inlined, and the inline magic
+    // lookup beats an out-of-line pext call.
+    if(slider_backend_supported(slider_pext) && !__builtin_cpu_is("znver1") && !__builtin_cpu_is("znver2"))
+    {
+        return slider_pext;
+    }
+#endif
+    return slider_magic;
+#endif
+}
+
+
+static void line_table_init(std::array<std::array<bitboard, squares>, squares>& betweens, std::array<std::array<bitboard, squares>, squares>& lines)
+{
+    for(int i = square_a1; i <= square_h8; i++)
+    {
+        for(int j = square_a1; j <= square_h8; j++)
         {
-            magics[sq].magic = 0;
+            square a = static_cast<square>(i);
+            square b = static_cast<square>(j);
 
-            // randomize magic number
-            while(set_cardinality((magics[sq].magic * magics[sq].mask) >> 56) < 6) magics[sq].magic = rng.sparse();
+            bitboard a_bb = square_set(a);
+            bitboard b_bb = square_set(b);
 
-            // make sure magic number maps every possible occupancy to index
-            // that looks up the correct sliding attack in attacks database
+            betweens[a][b] = empty_set;
+            lines[a][b] = empty_set;
 
-            // attacks database is built up alongside verifying the magic number
-            // use epoch to avoid resetting the attack table on failure
-            for (++count, j = 0; j < size; ++j)
+            // slider attacks from both squares on an empty board intersect in the line,
+            // and with the other square as blocker they intersect in the squares between
+            if(rook_attack_set(a, empty_set) & b_bb)
+            {
+                betweens[a][b] = rook_attack_set(a, b_bb) & rook_attack_set(b, a_bb);
+                lines[a][b] = (rook_attack_set(a, empty_set) & rook_attack_set(b, empty_set)) | a_bb | b_bb;
+            }
+            else if(bishop_attack_set(a, empty_set) & b_bb)
             {
-                unsigned index = magic_index(magics[sq], occupancy[j]);
-                if (epoch[index] < count)
-                {
-                    epoch[index] = count;
-                    magics[sq].attacks[index] = reference[j];
-                }
-                else if (magics[sq].attacks[index] != reference[j]) break;
+                betweens[a][b] = bishop_attack_set(a, b_bb) & bishop_attack_set(b, a_bb);
+                lines[a][b] = (bishop_attack_set(a, empty_set) & bishop_attack_set(b, empty_set)) | a_bb | b_bb;
             }
         }
     }
 }
 
 
-void attack_init(random& rng)
+void attack_init()
 {
-	const std::array<direction, 4> rook_directions{direction_n, direction_e, direction_s, direction_w};
-	const std::array<direction, 4> bishop_directions{direction_ne, direction_se, direction_sw, direction_nw};
-	const std::array<direction, 8> knight_directions{direction_nne, direction_ene, direction_ese, direction_sse, direction_ssw, direction_wsw, direction_wnw, direction_nnw};
-	const std::array<direction, 8> king_directions{direction_n, direction_ne, direction_e, direction_se, direction_s, direction_sw, direction_w, direction_nw};
+#ifdef CHESS_X86
+    if(slider_backend_supported(slider_pext))
+    {
+        pext_table_init(rook_pext_table.data(), rook_pexts, rook_table);
+        pext_table_init(bishop_pext_table.data(), bishop_pexts, bishop_table);
+    }
+#endif
+#ifdef CHESS_X86
+    slider_fill_avx2 = __builtin_cpu_supports("avx2");
+#endif
+    // the line tables are built with the slider lookups, which must be set up
+    if(!set_slider_backend(default_slider_backend()))
+    {
+        set_slider_backend(slider_magic);
+    }
 
-    ray_table_init(rook_attack_table.data(), rook_magics, rook_directions, rng);
-    ray_table_init(bishop_attack_table.data(), bishop_magics, bishop_directions, rng);
-    shift_table_init(knight_attack_table.data(), knight_directions);
-    shift_table_init(king_attack_table.data(), king_directions);
+    line_table_init(attack_table.betweens, attack_table.lines);
 }
 
 
@@ -2,6 +2,13 @@
 #define CHESS_ATTACK_HPP
 
 
+#include <array>
+#include <string>
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
 #include "set.hpp"
 
 
@@ -9,7 +16,95 @@ namespace chess
 {
 
 
-void attack_init(random& rng);
+/// Setwise slider attack set.
+///
+/// Computes the attacks of all given sliders at once with Kogge-Stone fills
+/// in the eight directions, without looking up attacks square by square. Uses
+/// AVX2 to fill four directions at a time where it is supported.
+///
+/// \param orthogonal Sliders moving along files and ranks (rooks and queens).
+/// \param diagonal Sliders moving along diagonals (bishops and queens).
+/// \param occupied Occupied squares.
+/// \returns Attacked squares.
+bitboard slider_attack_set(bitboard orthogonal, bitboard diagonal, bitboard occupied);
+
+
+/// Setwise slider attack set, without SIMD.
+///
+/// The fallback of slider_attack_set() where AVX2 is not supported, with one
+/// Kogge-Stone fill per direction.
+///
+/// \param orthogonal Sliders moving along files and ranks (rooks and queens).
+/// \param diagonal Sliders moving along diagonals (bishops and queens).
+/// \param occupied Occupied squares.
+/// \returns Attacked squares.
+constexpr bitboard slider_scalar_attack_set(bitboard orthogonal, bitboard diagonal, bitboard occupied)
+{
+    return set_ray<direction_n>(orthogonal, occupied)
+         | set_ray<direction_e>(orthogonal, occupied)
+         | set_ray<direction_s>(orthogonal, occupied)
+         | set_ray<direction_w>(orthogonal, occupied)
+         | set_ray<direction_ne>(diagonal, occupied)
+         | set_ray<direction_se>(diagonal, occupied)
+         | set_ray<direction_sw>(diagonal, occupied)
+         | set_ray<direction_nw>(diagonal, occupied);
+}
+
+
+/// Initialize attack tables.
+///
+/// Knight, king, rook and bishop attack tables are built at compile time, so
+/// this only sets up the tables of the selected slider backend and the
+/// between and line tables. It does not depend on any seed.
+void attack_init();
+
+
+/// Slider attack backends.
+///
+/// Rook and bishop attacks can be computed in different ways, with different
+/// speed and memory use depending on the host:
+/// - magic: multiply-shift indexed attack tables (about 840 kB),
+/// - pext: BMI2 PEXT indexed attack tables (about 840 kB, x86 with BMI2 only),
+/// - compact: obstruction difference on line masks, without any tables.
+enum slider_backend
+{
+    slider_magic,
+    slider_pext,
+    slider_compact,
+};
+
+
+/// Check if slider backend is supported.
+///
+/// \param b The backend.
+/// \returns Whether the backend can be used on this host.
+bool slider_backend_supported(slider_backend b);
+
+
+/// Select slider backend.
+///
+/// On initialization, the backend is selected from the CPU features of the
+/// host: PEXT where the library is built for BMI2 (for example with
+/// -march=native) and PEXT is fast, magic otherwise. Defining
+/// CHESS_SLIDER_BACKEND at build time (for example to slider_compact)
+/// overrides the default, unless the host does not support it.
+///
+/// \param b The backend.
+/// \returns Whether the backend is supported and was selected.
+bool set_slider_backend(slider_backend b);
+
+
+/// Selected slider backend.
+///
+/// \returns The backend used by rook_attack_set() and bishop_attack_set().
+slider_backend get_slider_backend();
+
+
+/// Name of slider backend.
+///
+/// \param b The backend.
+/// \returns Name of the backend.
+std::string to_string(slider_backend b);
 
 
 /// Set of all east pawn attacks.
@@ -20,7 +115,10 @@ void attack_init(random& rng);
 /// \param bb Set of pawns.
 /// \param s Side of pawns.
 /// \returns Attacked squares.
-bitboard pawn_east_attack_set(bitboard bb, side s);
+constexpr bitboard pawn_east_attack_set(bitboard bb, side s)
+{
+    return set_shift(bb, static_cast<direction>(forwards(s) + direction_e));
+}
 
 
 /// Set of all west pawn attacks.
@@ -31,7 +129,132 @@ bitboard pawn_east_attack_set(bitboard bb, side s);
 /// \param bb Set of pawns.
 /// \param s Side of pawns.
 /// \returns Attacked squares.
-bitboard pawn_west_attack_set(bitboard bb, side s);
+constexpr bitboard pawn_west_attack_set(bitboard bb, side s)
+{
+    return set_shift(bb, static_cast<direction>(forwards(s) + direction_w));
+}
+
+
+/// Set of all east pawn attacks, with side known at compile time.
+///
+/// \tparam s Side of pawns.
+/// \param bb Set of pawns.
+/// \returns Attacked squares.
+template<side s>
+constexpr bitboard pawn_east_attack_set(bitboard bb)
+{
+    return set_shift<static_cast<direction>(forwards(s) + direction_e)>(bb);
+}
+
+
+/// Set of all west pawn attacks, with side known at compile time.
+///
+/// \tparam s Side of pawns.
+/// \param bb Set of pawns.
+/// \returns Attacked squares.
+template<side s>
+constexpr bitboard pawn_west_attack_set(bitboard bb)
+{
+    return set_shift<static_cast<direction>(forwards(s) + direction_w)>(bb);
+}
+
+
+/// Slider attack lookup of a square.
+///
+/// The attacks of a rook or bishop are stored in a table indexed by the
+/// relevant occupancy (the mask), either through a magic multiply and shift
+/// or through PEXT. The lookups point to the tables of the selected backend,
+/// so that rook_attack_set() and bishop_attack_set() can be inlined.
+struct slider_lookup
+{
+    bitboard mask;
+    bitboard magic;
+    const bitboard* attacks;
+    unsigned shift;
+};
+
+
+/// Tables behind the inline attack functions.
+///
+/// Set up by attack_init() and set_slider_backend(), and read through the
+/// const accessors everywhere else.
+class attack_tables
+{
+public:
+    slider_backend backend() const { return active_backend; }
+    const slider_lookup& rook_lookup(square sq) const { return rook_lookups[sq]; }
+    const slider_lookup& bishop_lookup(square sq) const { return bishop_lookups[sq]; }
+    bitboard between(square a, square b) const { return betweens[a][b]; }
+    bitboard line(square a, square b) const { return lines[a][b]; }
+
+private:
+    friend void attack_init();
+    friend bool set_slider_backend(slider_backend b);
+
+    slider_backend active_backend = slider_magic;
+    std::array<slider_lookup, squares> rook_lookups{};
+    std::array<slider_lookup, squares> bishop_lookups{};
+    std::array<std::array<bitboard, squares>, squares> betweens{};
+    std::array<std::array<bitboard, squares>, squares> lines{};
+};
+
+extern attack_tables attack_table;
+
+
+/// Rook attacks by a backend that can not be inlined.
+///
+/// Used by rook_attack_set() for the compact backend, and for the PEXT
+/// backend when the library is not built for BMI2.
+bitboard rook_backend_attack_set(square sq, bitboard occupied);
+
+
+/// Bishop attacks by a backend that can not be inlined.
+///
+/// See rook_backend_attack_set().
+bitboard bishop_backend_attack_set(square sq, bitboard occupied);
+
+
+/// Set of squares one step away from each square of a set.
+///
+/// \param bb The set.
+/// \param knight Whether to step like a knight rather than like a king.
+/// \returns Squares reached.
+constexpr bitboard step_set(bitboard bb, bool knight)
+{
+    if(knight)
+    {
+        return set_shift<direction_nne>(bb) | set_shift<direction_ene>(bb)
+             | set_shift<direction_ese>(bb) | set_shift<direction_sse>(bb)
+             | set_shift<direction_ssw>(bb) | set_shift<direction_wsw>(bb)
+             | set_shift<direction_wnw>(bb) | set_shift<direction_nnw>(bb);
+    }
+
+    return set_shift<direction_n>(bb) | set_shift<direction_ne>(bb)
+         | set_shift<direction_e>(bb) | set_shift<direction_se>(bb)
+         | set_shift<direction_s>(bb) | set_shift<direction_sw>(bb)
+         | set_shift<direction_w>(bb) | set_shift<direction_nw>(bb);
+}
+
+
+/// Table of step sets of every square.
+///
+/// \param knight Whether to step like a knight rather than like a king.
+/// \returns Squares reached from each square.
+constexpr std::array<bitboard, squares> step_table(bool knight)
+{
+    std::array<bitboard, squares> table{};
+
+    for(int i = square_a1; i <= square_h8; i++)
+    {
+        table[i] = step_set(square_set(static_cast<square>(i)), knight);
+    }
+
+    return table;
+}
+
+
+inline constexpr std::array<bitboard, squares> knight_attack_table = step_table(true);
+inline constexpr std::array<bitboard, squares> king_attack_table = step_table(false);
 
 
 /// Set of all rook attacks.
@@ -42,7 +265,17 @@ bitboard pawn_west_attack_set(bitboard bb, side s);
 /// \param sq Position of rook.
 /// \param occupied Set of occupied squares.
 /// \returns Attacked squares.
-bitboard rook_attack_set(square sq, bitboard occupied);
+inline bitboard rook_attack_set(square sq, bitboard occupied)
+{
+    const slider_lookup& l = attack_table.rook_lookup(sq);
+
+#ifdef __BMI2__
+    if(attack_table.backend() == slider_pext) return l.attacks[_pext_u64(occupied, l.mask)];
+#endif
+    if(attack_table.backend() == slider_magic) return l.attacks[((occupied & l.mask) * l.magic) >> l.shift];
+
+    return rook_backend_attack_set(sq, occupied);
+}
 
 
 /// Set of all knight attacks.
@@ -51,7 +284,10 @@ bitboard rook_attack_set(square sq, bitboard occupied);
 ///
 /// \param sq Position of knight.
 /// \returns Attacked squares.
-bitboard knight_attack_set(square sq);
+constexpr bitboard knight_attack_set(square sq)
+{
+    return knight_attack_table[sq];
+}
 
 
 /// Set of all bishop attacks.
@@ -62,7 +298,17 @@ bitboard knight_attack_set(square sq);
 /// \param sq Position of bishop.
 /// \param occupied Set of occupied squares.
 /// \returns Attacked squares.
-bitboard bishop_attack_set(square sq, bitboard occupied);
+inline bitboard bishop_attack_set(square sq, bitboard occupied)
+{
+    const slider_lookup& l = attack_table.bishop_lookup(sq);
+
+#ifdef __BMI2__
+    if(attack_table.backend() == slider_pext) return l.attacks[_pext_u64(occupied, l.mask)];
+#endif
+    if(attack_table.backend() == slider_magic) return l.attacks[((occupied & l.mask) * l.magic) >> l.shift];
+
+    return bishop_backend_attack_set(sq, occupied);
+}
 
 
 /// Set of all queen attacks.
@@ -73,7 +319,10 @@ bitboard bishop_attack_set(square sq, bitboard occupied);
 /// \param sq Position of queen.
 /// \param occupied Set of occupied squares.
 /// \returns Attacked squares.
-bitboard queen_attack_set(square sq, bitboard occupied);
+inline bitboard queen_attack_set(square sq, bitboard occupied)
+{
+    return rook_attack_set(sq, occupied) | bishop_attack_set(sq, occupied);
+}
 
 
 /// Set of all king attacks.
@@ -82,7 +331,39 @@ bitboard queen_attack_set(square sq, bitboard occupied);
 ///
 /// \param sq Position of king.
 /// \returns Attacked squares.
-bitboard king_attack_set(square sq);
+constexpr bitboard king_attack_set(square sq)
+{
+    return king_attack_table[sq];
+}
+
+
+/// Set of squares between two squares.
+///
+/// Returns the squares strictly between two squares that share a rank, file
+/// or diagonal. If the squares are not aligned, the set is empty.
+///
+/// \param a First square.
+/// \param b Second square.
+/// \returns Squares between.
+inline bitboard between_set(square a, square b)
+{
+    return attack_table.between(a, b);
+}
+
+
+/// Set of squares on line through two squares.
+///
+/// Returns the whole rank, file or diagonal that passes through both squares,
+/// including the squares themselves. If the squares are not aligned, the set
+/// is empty.
+///
+/// \param a First square.
+/// \param b Second square.
+/// \returns Squares on line.
+inline bitboard line_set(square a, square b)
+{
+    return attack_table.line(a, b);
+}
 
 
 }
@@ -0,0 +1,454 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "side.hpp"
+#include "piece.hpp"
+#include "square.hpp"
+#include "direction.hpp"
+#include "set.hpp"
+#include "board.hpp"
+#include "position.hpp"
+#include "batch.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CHESS_X86
+#endif
+
+// the vector helpers below are always inlined, so their calling convention
+// does not depend on the instruction set they are compiled for
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+
+namespace chess
+{
+
+
+// Sets of several positions, one per lane. Operations on the vector type are
+// compiled to the widest SIMD instructions of the function they are used in.
+typedef bitboard bitboard_lanes __attribute__((vector_size(position_batch::lanes*sizeof(bitboard))));
+
+
+template<direction d>
+__attribute__((always_inline)) inline bitboard_lanes lanes_shift(bitboard_lanes bb)
+{
+    if constexpr(d > 0)
+    {
+        return (bb << static_cast<int>(d)) & ~shift_trim(d);
+    }
+    else
+    {
+        return (bb >> static_cast<int>(-d)) & ~shift_trim(d);
+    }
+}
+
+
+// Same as set_ray<d>(bb, occupied).
+template<direction d>
+__attribute__((always_inline)) inline bitboard_lanes lanes_ray(bitboard_lanes bb, bitboard_lanes occupied)
+{
+    constexpr int n = d > 0 ? d : -d;
+    bitboard_lanes empty = ~occupied & ~shift_trim(d);
+
+    if constexpr(d > 0)
+    {
+        bb |= empty & (bb << n);
+        empty &= empty << n;
+        bb |= empty & (bb << 2*n);
+        empty &= empty << 2*n;
+        bb |= empty & (bb << 4*n);
+    }
+    else
+    {
+        bb |= empty & (bb >> n);
+        empty &= empty >> n;
+        bb |= empty & (bb >> 2*n);
+        empty &= empty >> 2*n;
+        bb |= empty & (bb >> 4*n);
+    }
+
+    return lanes_shift<d>(bb);
+}
+
+
+// Number of set bits in each lane, there is no vector popcount before avx-512.
+__attribute__((always_inline)) inline bitboard_lanes lanes_cardinality(bitboard_lanes bb)
+{
+    bb = bb - ((bb >> 1) & 0x5555555555555555ULL);
+    bb = (bb & 0x3333333333333333ULL) + ((bb >> 2) & 0x3333333333333333ULL);
+    bb = (bb + (bb >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    bb += bb >> 8;
+    bb += bb >> 16;
+    bb += bb >> 32;
+    return bb & 0x7f;
+}
+
+
+// All ones in lanes with any bit set, zero in others.
+__attribute__((always_inline)) inline bitboard_lanes lanes_any(bitboard_lanes bb)
+{
+    return reinterpret_cast<bitboard_lanes>(bb != 0);
+}
+
+
+__attribute__((always_inline)) inline bitboard_lanes lanes_load(const std::vector<bitboard>& sets, std::size_t i)
+{
+    bitboard_lanes bb;
+    std::memcpy(&bb, sets.data() + i, sizeof(bb));
+    return bb;
+}
+
+
+struct batch_kernels
+{
+    // pieces of one side in a register
+    struct army
+    {
+        bitboard_lanes pawns;
+        bitboard_lanes knights;
+        bitboard_lanes orthogonal;
+        bitboard_lanes diagonal;
+        bitboard_lanes king;
+
+        __attribute__((always_inline)) army(const position_batch::army& a, std::size_t i):
+        pawns{lanes_load(a.pawns, i)},
+        knights{lanes_load(a.knights, i)},
+        orthogonal{lanes_load(a.orthogonal, i)},
+        diagonal{lanes_load(a.diagonal, i)},
+        king{lanes_load(a.king, i)}
+        {}
+
+        __attribute__((always_inline)) bitboard_lanes all() const
+        {
+            return pawns | knights | orthogonal | diagonal | king;
+        }
+    };
+
+    __attribute__((always_inline)) static bitboard_lanes knight_attacks(bitboard_lanes bb)
+    {
+        return lanes_shift<direction_nne>(bb) | lanes_shift<direction_ene>(bb)
+             | lanes_shift<direction_ese>(bb) | lanes_shift<direction_sse>(bb)
+             | lanes_shift<direction_ssw>(bb) | lanes_shift<direction_wsw>(bb)
+             | lanes_shift<direction_wnw>(bb) | lanes_shift<direction_nnw>(bb);
+    }
+
+    __attribute__((always_inline)) static bitboard_lanes king_attacks(bitboard_lanes bb)
+    {
+        return lanes_shift<direction_n>(bb) | lanes_shift<direction_ne>(bb)
+             | lanes_shift<direction_e>(bb) | lanes_shift<direction_se>(bb)
+             | lanes_shift<direction_s>(bb) | lanes_shift<direction_sw>(bb)
+             | lanes_shift<direction_w>(bb) | lanes_shift<direction_nw>(bb);
+    }
+
+    __attribute__((always_inline)) static bitboard_lanes slider_attacks(bitboard_lanes orthogonal, bitboard_lanes diagonal, bitboard_lanes occupied)
+    {
+        return lanes_ray<direction_n>(orthogonal, occupied) | lanes_ray<direction_e>(orthogonal, occupied)
+             | lanes_ray<direction_s>(orthogonal, occupied) | lanes_ray<direction_w>(orthogonal, occupied)
+             | lanes_ray<direction_ne>(diagonal, occupied) | lanes_ray<direction_se>(diagonal, occupied)
+             | lanes_ray<direction_sw>(diagonal, occupied) | lanes_ray<direction_nw>(diagonal, occupied);
+    }
+
+    // squares attacked by the side to move (moving north) or the other side
+    template<bool us>
+    __attribute__((always_inline)) static bitboard_lanes attacks(const army& a, bitboard_lanes occupied)
+    {
+        bitboard_lanes pawn_attacks = us ? lanes_shift<direction_ne>(a.pawns) | lanes_shift<direction_nw>(a.pawns)
+                                         : lanes_shift<direction_se>(a.pawns) | lanes_shift<direction_sw>(a.pawns);
+
+        return pawn_attacks | knight_attacks(a.knights) | king_attacks(a.king) | slider_attacks(a.orthogonal, a.diagonal, occupied);
+    }
+
+    // rays from the king in one direction: checks by sliders, the squares
+    // blocking them, and pieces of the side to move pinned along the ray
+    template<direction d>
+    __attribute__((always_inline)) static void king_ray(bitboard_lanes king, bitboard_lanes occupied, bitboard_lanes own, bitboard_lanes sliders, bitboard_lanes& checkers, bitboard_lanes& blocks, bitboard_lanes& pinned)
+    {
+        bitboard_lanes ray = lanes_ray<d>(king, occupied);
+        bitboard_lanes first = ray & own;
+
+        checkers |= ray & sliders;
+        blocks |= ray & lanes_any(ray & sliders);
+        pinned = first & lanes_any(lanes_ray<d>(first, occupied) & sliders);
+    }
+
+    // moves of sliders in one direction, fills from different pieces in the
+    // same direction never overlap so the moves can be counted setwise
+    template<direction d>
+    __attribute__((always_inline)) static bitboard_lanes slider_count(bitboard_lanes sliders, bitboard_lanes pinned, bitboard_lanes axis, bitboard_lanes occupied, bitboard_lanes targets)
+    {
+        return lanes_cardinality(lanes_ray<d>(sliders & (~pinned | axis), occupied) & targets);
+    }
+
+    // moves of pawns on the promotion rank count once per promotion piece
+    __attribute__((always_inline)) static bitboard_lanes pawn_count(bitboard_lanes tos)
+    {
+        constexpr bitboard promote_rank = rank_set(rank_8);
+        return lanes_cardinality(tos & ~promote_rank) + 4*lanes_cardinality(tos & promote_rank);
+    }
+
+    // whether the king is safe after an en passant capture from a square
+    __attribute__((always_inline)) static bitboard_lanes en_passant_count(const army& us, const army& them, bitboard_lanes occupied, bitboard_lanes from, bitboard_lanes to)
+    {
+        bitboard_lanes captured = lanes_shift<direction_s>(to);
+        bitboard_lanes after = (occupied ^ from ^ captured) | to;
+        bitboard_lanes king = us.king;
+
+        bitboard_lanes attackers = (knight_attacks(king) & them.knights)
+                                 | ((lanes_shift<direction_ne>(king) | lanes_shift<direction_nw>(king)) & them.pawns & ~captured)
+                                 | (slider_attacks(king, bitboard_lanes{}, after) & them.orthogonal)
+                                 | (slider_attacks(bitboard_lanes{}, king, after) & them.diagonal);
+
+        return lanes_any(from) & ~lanes_any(attackers) & 1;
+    }
+
+    template<bool counts, bool checks, bool attacks_of_us>
+    __attribute__((always_inline)) static void evaluate(const position_batch& b, std::size_t begin, std::size_t end, int* move_counts, std::uint8_t* check_flags, bitboard* attack_sets)
+    {
+        constexpr std::size_t width = position_batch::lanes;
+
+        for(std::size_t i = begin; i < end; i += width)
+        {
+            army us(b.us, i);
+            army them(b.them, i);
+
+            bitboard_lanes own = us.all();
+            bitboard_lanes occupied = own | them.all();
+            bitboard_lanes results[3];
+
+            if constexpr(attacks_of_us)
+            {
+                results[0] = attacks<true>(us, occupied);
+            }
+
+            if constexpr(checks)
+            {
+                results[1] = lanes_any(attacks<false>(them, occupied) & us.king) & 1;
+            }
+
+            if constexpr(counts)
+            {
+                results[2] = legal_count(b, i, us, them, own, occupied);
+            }
+
+            for(std::size_t j = 0; j < width; j++)
+            {
+                if constexpr(attacks_of_us) attack_sets[i + j] = results[0][j];
+                if constexpr(checks) check_flags[i + j] = results[1][j];
+                if constexpr(counts) move_counts[i + j] = results[2][j];
+            }
+        }
+    }
+
+    __attribute__((always_inline)) static bitboard_lanes legal_count(const position_batch& b, std::size_t i, const army& us, const army& them, bitboard_lanes own, bitboard_lanes occupied)
+    {
+        bitboard_lanes king = us.king;
+
+        // checkers, the squares that block slider checks and pinned pieces
+        bitboard_lanes checkers = (knight_attacks(king) & them.knights)
+                                | ((lanes_shift<direction_ne>(king) | lanes_shift<direction_nw>(king)) & them.pawns);
+        bitboard_lanes blocks = {};
+        bitboard_lanes pinned_n, pinned_e, pinned_s, pinned_w, pinned_ne, pinned_se, pinned_sw, pinned_nw;
+
+        king_ray<direction_n>(king, occupied, own, them.orthogonal, checkers, blocks, pinned_n);
+        king_ray<direction_e>(king, occupied, own, them.orthogonal, checkers, blocks, pinned_e);
+        king_ray<direction_s>(king, occupied, own, them.orthogonal, checkers, blocks, pinned_s);
+        king_ray<direction_w>(king, occupied, own, them.orthogonal, checkers, blocks, pinned_w);
+        king_ray<direction_ne>(king, occupied, own, them.diagonal, checkers, blocks, pinned_ne);
+        king_ray<direction_se>(king, occupied, own, them.diagonal, checkers, blocks, pinned_se);
+        king_ray<direction_sw>(king, occupied, own, them.diagonal, checkers, blocks, pinned_sw);
+        king_ray<direction_nw>(king, occupied, own, them.diagonal, checkers, blocks, pinned_nw);
+
+        // pinned pieces can only move along the line through king and pinner
+        bitboard_lanes file_pins = pinned_n | pinned_s;
+        bitboard_lanes rank_pins = pinned_e | pinned_w;
+        bitboard_lanes diagonal_pins = pinned_ne | pinned_sw;
+        bitboard_lanes antidiagonal_pins = pinned_nw | pinned_se;
+        bitboard_lanes pinned = file_pins | rank_pins | diagonal_pins | antidiagonal_pins;
+
+        // when checked, other pieces must capture the checker or block the check
+        // and when double checked, only the king can move
+        bitboard_lanes checked = lanes_any(checkers);
+        bitboard_lanes check_mask = (checked & (checkers | blocks)) | ~checked;
+        check_mask &= ~lanes_any(checkers & (checkers - 1));
+
+        bitboard_lanes targets = ~own & check_mask;
+        bitboard_lanes enemies = occupied & ~own;
+
+        // pawn moves
+        bitboard_lanes single_push_tos = lanes_shift<direction_n>(us.pawns & (~pinned | file_pins)) & ~occupied;
+        bitboard_lanes double_push_tos = lanes_shift<direction_n>(single_push_tos & rank_set(rank_3)) & ~occupied & targets;
+        bitboard_lanes attack_east_tos = lanes_shift<direction_ne>(us.pawns & (~pinned | diagonal_pins)) & enemies & targets;
+        bitboard_lanes attack_west_tos = lanes_shift<direction_nw>(us.pawns & (~pinned | antidiagonal_pins)) & enemies & targets;
+
+        bitboard_lanes count = pawn_count(single_push_tos & targets) + lanes_cardinality(double_push_tos)
+                             + pawn_count(attack_east_tos) + pawn_count(attack_west_tos);
+
+        // en passant is tested by the occupancy after the capture
+        bitboard_lanes ep = lanes_load(b.en_passant, i);
+        count += en_passant_count(us, them, occupied, lanes_shift<direction_sw>(ep) & us.pawns, ep);
+        count += en_passant_count(us, them, occupied, lanes_shift<direction_se>(ep) & us.pawns, ep);
+
+        // knight moves, pinned knights can not move
+        bitboard_lanes knights = us.knights & ~pinned;
+
+        count += lanes_cardinality(lanes_shift<direction_nne>(knights) & targets) + lanes_cardinality(lanes_shift<direction_ene>(knights) & targets)
+               + lanes_cardinality(lanes_shift<direction_ese>(knights) & targets) + lanes_cardinality(lanes_shift<direction_sse>(knights) & targets)
+               + lanes_cardinality(lanes_shift<direction_ssw>(knights) & targets) + lanes_cardinality(lanes_shift<direction_wsw>(knights) & targets)
+               + lanes_cardinality(lanes_shift<direction_wnw>(knights) & targets) + lanes_cardinality(lanes_shift<direction_nnw>(knights) & targets);
+
+        // slider moves
+        count += slider_count<direction_n>(us.orthogonal, pinned, file_pins, occupied, targets)
+               + slider_count<direction_s>(us.orthogonal, pinned, file_pins, occupied, targets)
+               + slider_count<direction_e>(us.orthogonal, pinned, rank_pins, occupied, targets)
+               + slider_count<direction_w>(us.orthogonal, pinned, rank_pins, occupied, targets)
+               + slider_count<direction_ne>(us.diagonal, pinned, diagonal_pins, occupied, targets)
+               + slider_count<direction_sw>(us.diagonal, pinned, diagonal_pins, occupied, targets)
+               + slider_count<direction_nw>(us.diagonal, pinned, antidiagonal_pins, occupied, targets)
+               + slider_count<direction_se>(us.diagonal, pinned, antidiagonal_pins, occupied, targets);
+
+        // king moves, the king can not hide behind itself from a slider
+        bitboard_lanes danger = attacks<false>(them, occupied ^ king);
+        count += lanes_cardinality(king_attacks(king) & ~own & ~danger);
+
+        // castling, the rights are stored as the destination squares of the king
+        bitboard_lanes castle = lanes_load(b.castle, i);
+        constexpr bitboard e1 = square_set(square_e1);
+        constexpr bitboard f1 = square_set(square_f1);
+        constexpr bitboard g1 = square_set(square_g1);
+        constexpr bitboard d1 = square_set(square_d1);
+        constexpr bitboard c1 = square_set(square_c1);
+        constexpr bitboard b1 = square_set(square_b1);
+
+        count += lanes_any(castle & g1) & ~lanes_any(occupied & (f1 | g1)) & ~lanes_any(danger & (e1 | f1 | g1)) & 1;
+        count += lanes_any(castle & c1) & ~lanes_any(occupied & (b1 | c1 | d1)) & ~lanes_any(danger & (c1 | d1 | e1)) & 1;
+
+        return count;
+    }
+
+    template<bool counts, bool checks, bool attacks_of_us>
+    static void run(const position_batch& b, int* move_counts, std::uint8_t* check_flags, bitboard* attack_sets)
+    {
+#ifdef CHESS_X86
+        if(__builtin_cpu_supports("avx2"))
+        {
+            evaluate_avx2<counts, checks, attacks_of_us>(b, move_counts, check_flags, attack_sets);
+            return;
+        }
+#endif
+        evaluate<counts, checks, attacks_of_us>(b, 0, b.us.king.size(), move_counts, check_flags, attack_sets);
+    }
+
+#ifdef CHESS_X86
+    template<bool counts, bool checks, bool attacks_of_us>
+    __attribute__((target("avx2")))
+    static void evaluate_avx2(const position_batch& b, int* move_counts, std::uint8_t* check_flags, bitboard* attack_sets)
+    {
+        evaluate<counts, checks, attacks_of_us>(b, 0, b.us.king.size(), move_counts, check_flags, attack_sets);
+    }
+#endif
+};
+
+
+position_batch::position_batch():
+count{0}
+{}
+
+void position_batch::push_back(const position& p)
+{
+    const board& bd = p.get_board();
+    side s = p.get_turn();
+
+    // positions are stored with the side to move moving north
+    auto relative = [s](bitboard bb)
+    {
+        return s == side_white ? bb : __builtin_bswap64(bb);
+    };
+
+    // pad the arrays to a whole number of registers with empty positions
+    if(count % lanes == 0)
+    {
+        for(army* a: {&us, &them})
+        {
+            for(std::vector<bitboard>* sets: {&a->pawns, &a->knights, &a->orthogonal, &a->diagonal, &a->king})
+            {
+                sets->resize(count + lanes, empty_set);
+            }
+        }
+
+        castle.resize(count + lanes, empty_set);
+        en_passant.resize(count + lanes, empty_set);
+    }
+
+    for(auto [a, as]: {std::pair{&us, s}, std::pair{&them, opponent(s)}})
+    {
+        bitboard queens = bd.piece_set(piece_queen, as);
+        a->pawns[count] = relative(bd.piece_set(piece_pawn, as));
+        a->knights[count] = relative(bd.piece_set(piece_knight, as));
+        a->orthogonal[count] = relative(bd.piece_set(piece_rook, as) | queens);
+        a->diagonal[count] = relative(bd.piece_set(piece_bishop, as) | queens);
+        a->king[count] = relative(bd.piece_set(piece_king, as));
+    }
+
+    castle[count] = (p.can_castle_kingside(s) ? square_set(square_g1) : empty_set)
+                  | (p.can_castle_queenside(s) ? square_set(square_c1) : empty_set);
+    en_passant[count] = p.get_en_passant() != square_none ? relative(square_set(p.get_en_passant())) : empty_set;
+    turns.push_back(s);
+
+    count++;
+}
+
+void position_batch::clear()
+{
+    for(army* a: {&us, &them})
+    {
+        for(std::vector<bitboard>* sets: {&a->pawns, &a->knights, &a->orthogonal, &a->diagonal, &a->king})
+        {
+            sets->clear();
+        }
+    }
+
+    castle.clear();
+    en_passant.clear();
+    turns.clear();
+    count = 0;
+}
+
+std::size_t position_batch::size() const
+{
+    return count;
+}
+
+std::vector<int> position_batch::legal_move_counts() const
+{
+    std::vector<int> counts(us.king.size());
+    batch_kernels::run<true, false, false>(*this, counts.data(), nullptr, nullptr);
+    counts.resize(count);
+    return counts;
+}
+
+std::vector<std::uint8_t> position_batch::checks() const
+{
+    std::vector<std::uint8_t> flags(us.king.size());
+    batch_kernels::run<false, true, false>(*this, nullptr, flags.data(), nullptr);
+    flags.resize(count);
+    return flags;
+}
+
+std::vector<bitboard> position_batch::attack_sets() const
+{
+    std::vector<bitboard> attacks(us.king.size());
+    batch_kernels::run<false, false, true>(*this, nullptr, nullptr, attacks.data());
+    attacks.resize(count);
+
+    // back from the point of view of the side to move
+    for(std::size_t i = 0; i < count; i++)
+    {
+        attacks[i] = turns[i] == side_white ? attacks[i] : __builtin_bswap64(attacks[i]);
+    }
+
+    return attacks;
+}
+
+
+}
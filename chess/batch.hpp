@@ -0,0 +1,95 @@
+#ifndef CHESS_BATCH_HPP
+#define CHESS_BATCH_HPP
+
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "side.hpp"
+#include "set.hpp"
+#include "position.hpp"
+
+
+namespace chess
+{
+
+
+/// Batch of positions.
+///
+/// Stores the piece sets of many positions in structure of arrays layout,
+/// one array per set, so that queries over the whole batch can process
+/// several positions per SIMD register. Positions are stored from the point of
+/// view of the side to move (flipped vertically when black is to move), which
+/// makes the work the same for every position in a register.
+///
+/// The queries compute their results with setwise operations only, without
+/// generating moves.
+class position_batch
+{
+public:
+    /// Empty batch.
+    position_batch();
+
+    /// Add position.
+    ///
+    /// \param p The position.
+    void push_back(const position& p);
+
+    /// Remove all positions.
+    void clear();
+
+    /// Number of positions.
+    ///
+    /// \returns Number of positions.
+    std::size_t size() const;
+
+    /// Legal move counts.
+    ///
+    /// Counts the legal moves of each position, like the size of
+    /// position::moves() but without generating them.
+    ///
+    /// \returns Number of legal moves, per position.
+    std::vector<int> legal_move_counts() const;
+
+    /// Check flags.
+    ///
+    /// \returns Whether the side to move is checked, per position.
+    std::vector<std::uint8_t> checks() const;
+
+    /// Attack sets.
+    ///
+    /// Same as board::attack_set() for the side to move.
+    ///
+    /// \returns Squares attacked by the side to move, per position.
+    std::vector<bitboard> attack_sets() const;
+
+    /// Positions per SIMD register.
+    static constexpr std::size_t lanes = 4;
+
+private:
+    // pieces of one side, queens count as both orthogonal and diagonal sliders
+    struct army
+    {
+        std::vector<bitboard> pawns;
+        std::vector<bitboard> knights;
+        std::vector<bitboard> orthogonal;
+        std::vector<bitboard> diagonal;
+        std::vector<bitboard> king;
+    };
+
+    std::size_t count;
+    army us;
+    army them;
+    std::vector<bitboard> castle;
+    std::vector<bitboard> en_passant;
+    std::vector<side> turns;
+
+    friend struct batch_kernels;
+};
+
+
+}
+
+
+#endif
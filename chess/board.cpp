@@ -9,6 +9,7 @@
 #include "zobrist.hpp"
 #include "board.hpp"
 #include "attack.hpp"
+#include "probe.hpp"
 
 
 namespace chess
@@ -64,7 +65,8 @@ square_sides{},
 square_pieces{},
 side_sets{},
 piece_sets{},
-zobrist_hash{0}
+zobrist_hash{0},
+attack_maps{false}
 {
     square_sides.fill(side_none);
     square_pieces.fill(piece_none);
@@ -78,6 +80,37 @@ zobrist_hash{0}
     }
 }
 
+board::board(const board& other):
+square_sides{other.square_sides},
+square_pieces{other.square_pieces},
+side_sets{other.side_sets},
+piece_sets{other.piece_sets},
+zobrist_hash{other.zobrist_hash},
+attack_maps{other.attack_maps}
+{
+    if(attack_maps)
+    {
+        square_attacks = other.square_attacks;
+    }
+}
+
+board& board::operator=(const board& other)
+{
+    square_sides = other.square_sides;
+    square_pieces = other.square_pieces;
+    side_sets = other.side_sets;
+    piece_sets = other.piece_sets;
+    zobrist_hash = other.zobrist_hash;
+    attack_maps = other.attack_maps;
+
+    if(attack_maps)
+    {
+        square_attacks = other.square_attacks;
+    }
+
+    return *this;
+}
+
 std::pair<side, piece> board::get(square sq) const
 {
     return {square_sides[sq], square_pieces[sq]};
@@ -85,6 +118,8 @@ std::pair<side, piece> board::get(square sq) const
 
 void board::set(square sq, side s, piece p)
 {
+    CHESS_PROBE(set);
+
     side s_prev = square_sides[sq];
     piece p_prev = square_pieces[sq];
 
@@ -104,6 +139,28 @@ void board::set(square sq, side s, piece p)
         piece_sets[p] = set_insert(piece_sets[p], sq);
         zobrist_hash ^= zobrist_piece_key(sq, s, p);
     }
+
+    if(attack_maps)
+    {
+        std::array<bitboard, squares>& attacks = square_attacks;
+        attacks[sq] = piece_attack_set(sq);
+
+        // sliders seeing the square are blocked or unblocked by it
+        // if the square was and is occupied, their rays are unchanged
+        if((p_prev == piece_none) != (p == piece_none))
+        {
+            bitboard occupied = occupied_set();
+            bitboard sliders = (rook_attack_set(sq, occupied) & (piece_sets[piece_rook] | piece_sets[piece_queen]))
+                             | (bishop_attack_set(sq, occupied) & (piece_sets[piece_bishop] | piece_sets[piece_queen]));
+
+            while(sliders)
+            {
+                square from = set_first(sliders);
+                sliders = set_erase(sliders, from);
+                attacks[from] = piece_attack_set(from);
+            }
+        }
+    }
 }
 
 void board::clear()
@@ -123,6 +180,11 @@ void board::clear()
     side_sets[side_black] = 0;
 
     zobrist_hash = 0;
+
+    if(attack_maps)
+    {
+        square_attacks.fill(empty_set);
+    }
 }
 
 bitboard board::side_set(side s) const
@@ -141,6 +203,118 @@ bitboard board::occupied_set() const
 }
 
 bitboard board::attack_set(side s) const
+{
+    CHESS_PROBE(attack_set);
+
+    if(attack_maps)
+    {
+        bitboard pieces = side_sets[s];
+        bitboard attacks = empty_set;
+
+        while(pieces)
+        {
+            square sq = set_first(pieces);
+            pieces = set_erase(pieces, sq);
+            attacks |= square_attacks[sq];
+        }
+
+        return attacks;
+    }
+
+    return s == side_white ? attack_set<side_white>() : attack_set<side_black>();
+}
+
+bitboard board::attackers_to(square sq, bitboard occupied) const
+{
+    return attackers_to<side_white>(sq, occupied) | attackers_to<side_black>(sq, occupied);
+}
+
+template<side s>
+bitboard board::attackers_to(square sq, bitboard occupied) const
+{
+    // a piece on the square attacks the same squares as the pieces attacking it,
+    // except pawns, which attack in the opposite direction
+    bitboard sq_bb = square_set(sq);
+    bitboard rooks = (piece_sets[piece_rook] | piece_sets[piece_queen]) & side_sets[s];
+    bitboard bishops = (piece_sets[piece_bishop] | piece_sets[piece_queen]) & side_sets[s];
+
+    return ((pawn_east_attack_set<opponent(s)>(sq_bb) | pawn_west_attack_set<opponent(s)>(sq_bb)) & piece_sets[piece_pawn] & side_sets[s])
+         | (knight_attack_set(sq) & piece_sets[piece_knight] & side_sets[s])
+         | (king_attack_set(sq) & piece_sets[piece_king] & side_sets[s])
+         | (rooks ? rook_attack_set(sq, occupied) & rooks : empty_set)
+         | (bishops ? bishop_attack_set(sq, occupied) & bishops : empty_set);
+}
+
+template bitboard board::attackers_to<side_white>(square sq, bitboard occupied) const;
+template bitboard board::attackers_to<side_black>(square sq, bitboard occupied) const;
+
+bool board::is_attacked(square sq, side s) const
+{
+    bitboard occupied = occupied_set();
+    return s == side_white ? attackers_to<side_white>(sq, occupied) : attackers_to<side_black>(sq, occupied);
+}
+
+bitboard board::fill_attack_set(side s) const
+{
+    bitboard knights = piece_set(piece_knight, s);
+    bitboard queens = piece_set(piece_queen, s);
+    bitboard kings = piece_set(piece_king, s);
+
+    bitboard attacks = slider_attack_set(piece_set(piece_rook, s) | queens, piece_set(piece_bishop, s) | queens, occupied_set());
+
+    attacks |= pawn_east_attack_set(piece_set(piece_pawn, s), s);
+    attacks |= pawn_west_attack_set(piece_set(piece_pawn, s), s);
+
+    attacks |= step_set(knights, true) | step_set(kings, false);
+
+    return attacks;
+}
+
+void board::set_attack_maps(bool enabled)
+{
+    attack_maps = enabled;
+
+    if(!enabled)
+    {
+        return;
+    }
+
+    square_attacks.fill(empty_set);
+
+    bitboard occupied = occupied_set();
+
+    while(occupied)
+    {
+        square sq = set_first(occupied);
+        occupied = set_erase(occupied, sq);
+        square_attacks[sq] = piece_attack_set(sq);
+    }
+}
+
+bool board::has_attack_maps() const
+{
+    return attack_maps;
+}
+
+bitboard board::piece_attack_set(square sq) const
+{
+    bitboard occupied = occupied_set();
+
+    switch(square_pieces[sq])
+    {
+    case piece_pawn:    return pawn_east_attack_set(square_set(sq), square_sides[sq]) | pawn_west_attack_set(square_set(sq), square_sides[sq]);
+    case piece_rook:    return rook_attack_set(sq, occupied);
+    case piece_knight:  return knight_attack_set(sq);
+    case piece_bishop:  return bishop_attack_set(sq, occupied);
+    case piece_queen:   return queen_attack_set(sq, occupied);
+    case piece_king:    return king_attack_set(sq);
+    case piece_none:
+    default:            return empty_set;
+    }
+}
+
+template<side s>
+bitboard board::attack_set() const
 {
     bitboard pawns = piece_set(piece_pawn, s);
     bitboard rooks = piece_set(piece_rook, s);
@@ -151,8 +325,8 @@ bitboard board::attack_set(side s) const
 
     bitboard attacks = 0;
 
-    attacks |= set_shift(pawns, static_cast<direction>(forwards(s) + direction_e));
-    attacks |= set_shift(pawns, static_cast<direction>(forwards(s) + direction_w));
+    attacks |= pawn_east_attack_set<s>(pawns);
+    attacks |= pawn_west_attack_set<s>(pawns);
 
     while(rooks)
     {
@@ -2,6 +2,7 @@
 #define CHESS_BOARD_HPP
 
 
+#include <array>
 #include <string>
 #include <utility>
 #include <unordered_map>
@@ -39,6 +40,20 @@ public:
     /// \param pieces The piece placement.
     board(const std::unordered_map<square, std::pair<side, piece>>& pieces);
 
+    /// Copy board.
+    ///
+    /// Attack maps are copied along with the board only if they are
+    /// maintained.
+    ///
+    /// \param other The board to copy.
+    board(const board& other);
+
+    /// Copy board.
+    ///
+    /// \param other The board to copy.
+    /// \returns This board.
+    board& operator=(const board& other);
+
     /// Get side and piece at the given square.
     ///
     /// Returns the side and piece at the given square. Both side and piece
@@ -90,12 +105,71 @@ public:
 
     /// Attack set.
     ///
-    /// Returns the set of all squares attacked by a given side.
+    /// Returns the set of all squares attacked by a given side. With attack
+    /// maps enabled, the stored attacks of each piece are combined, otherwise
+    /// the attacks of every piece of the side are computed.
     ///
     /// \param s The side.
     /// \returns Squares attacked by side.
     bitboard attack_set(side s) const;
 
+    /// Attackers of square.
+    ///
+    /// Returns the pieces of both sides that attack a square, found by looking
+    /// up the attacks of each piece type from the square itself. Sliders are
+    /// blocked by the given occupancy, which makes it possible to ask what
+    /// attacks a square after pieces are removed or moved.
+    ///
+    /// \param sq The square.
+    /// \param occupied Occupied squares.
+    /// \returns Squares of pieces attacking the square.
+    bitboard attackers_to(square sq, bitboard occupied) const;
+
+    /// Attackers of square from one side.
+    ///
+    /// Same as attackers_to(sq, occupied), but only pieces of side s.
+    ///
+    /// \tparam s The attacking side.
+    /// \param sq The square.
+    /// \param occupied Occupied squares.
+    /// \returns Squares of pieces of side s attacking the square.
+    template<side s> bitboard attackers_to(square sq, bitboard occupied) const;
+
+    /// Square attacked.
+    ///
+    /// Checks if any piece of a side attacks a square on the current board.
+    ///
+    /// \param sq The square.
+    /// \param s The attacking side.
+    /// \returns Whether the square is attacked.
+    bool is_attacked(square sq, side s) const;
+
+    /// Setwise attack set.
+    ///
+    /// Returns the same set as attack_set(), but computes it with shifts and
+    /// fills of whole piece sets instead of a lookup per piece. The number of
+    /// instructions does not depend on the number of pieces.
+    ///
+    /// \param s The side.
+    /// \returns Squares attacked by side.
+    bitboard fill_attack_set(side s) const;
+
+    /// Enable or disable attack maps.
+    ///
+    /// With attack maps enabled, set() incrementally updates the stored
+    /// attacks of the changed piece and of the sliders whose rays pass through
+    /// the changed square. This makes set() more expensive and attack_set()
+    /// a few loads instead of an attack computation per piece. Disabled by
+    /// default, in which case the maps are neither updated nor copied.
+    ///
+    /// \param enabled Whether to maintain attack maps.
+    void set_attack_maps(bool enabled);
+
+    /// Attack maps flag.
+    ///
+    /// \returns Whether attack maps are maintained.
+    bool has_attack_maps() const;
+
     /// Board hash.
     ///
     /// Returns the Zobrist hash of the board (piece placement).
@@ -113,6 +187,9 @@ public:
     std::string to_string(bool coords = true) const;
 
 private:
+    template<side s> bitboard attack_set() const;
+    bitboard piece_attack_set(square sq) const;
+
     std::array<side, squares> square_sides;
     std::array<piece, squares> square_pieces;
 
@@ -120,6 +197,10 @@ private:
     std::array<bitboard, pieces> piece_sets;
 
     std::size_t zobrist_hash;
+
+    // attacks of the piece on each square, only valid when attack maps are maintained
+    bool attack_maps;
+    std::array<bitboard, squares> square_attacks;
 };
 
 
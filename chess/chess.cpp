@@ -11,7 +11,7 @@ void init(std::size_t seed)
 {
     random rng(seed);
    
-    attack_init(rng);
+    attack_init();
     zobrist_init(rng);
 }
 
@@ -6,9 +6,12 @@
 #include "direction.hpp"
 #include "game.hpp"
 #include "attack.hpp"
+#include "batch.hpp"
 #include "move.hpp"
+#include "picker.hpp"
 #include "piece.hpp"
 #include "position.hpp"
+#include "probe.hpp"
 #include "random.hpp"
 #include "set.hpp"
 #include "side.hpp"
@@ -23,8 +26,8 @@ namespace chess
 /// Initialize library.
 ///
 /// Sets up internal state such as attack tables and Zobrist hash keys.
-/// The default seed seems to work fine but there might exist one that is both
-/// faster and yields better pseudorandom numbers.
+/// The seed is only used for the Zobrist hash keys, attack tables are the
+/// same for every seed.
 void init(std::size_t seed = 2147483647ULL);
 
 
@@ -47,7 +47,10 @@ const int directions = 16;
 ///
 /// \param d Direction to get opposite of.
 /// \returns Opposite direction. 
-direction opposite(direction d);
+constexpr direction opposite(direction d)
+{
+    return static_cast<direction>(-d);
+}
 
 /// Forward direction for given side.
 ///
@@ -55,7 +58,19 @@ direction opposite(direction d);
 ///
 /// \param s The side.
 /// \returns Forwards for given side.
-direction forwards(side s);
+constexpr direction forwards(side s)
+{
+    switch(s)
+    {
+    case side_white:
+        return direction_n;
+    case side_black:
+        return direction_s;
+    case side_none:
+    default:
+        return direction_none;
+    }
+}
 
 direction direction_of(square from, square to);
 
@@ -1,4 +1,5 @@
 #include <array>
+#include <cstdint>
 #include <string>
 
 #include "piece.hpp"
@@ -13,13 +14,15 @@ namespace chess
 move::move():
 from{square_none},
 to{square_none},
-promote{piece_none}
+promote{piece_none},
+flags{move_flag_unknown}
 {}
 
-move::move(square from, square to, piece promote):
+move::move(square from, square to, piece promote, unsigned flags):
 from{from},
 to{to},
-promote{promote}
+promote{promote},
+flags{static_cast<std::uint8_t>(flags)}
 {}
 
 move move::from_lan(std::string_view lan)
@@ -46,5 +49,138 @@ bool move::is_null() const
     return from == square_none || to == square_none;
 }
 
+bool move::operator==(const move& m) const
+{
+    return from == m.from && to == m.to && promote == m.promote;
+}
+
+
+static const std::uint16_t packed_square_mask = 0x3F;
+static const std::uint16_t packed_to_shift = 6;
+static const std::uint16_t packed_kind_shift = 12;
+static const std::uint16_t packed_promote_flag = 0x8000;
+
+// kinds of moves that are not promotions, in bits 12-14
+enum packed_kind
+{
+    packed_quiet,
+    packed_capture,
+    packed_double_push,
+    packed_en_passant,
+    packed_castle,
+    packed_unknown = 7,
+};
+
+packed_move::packed_move():
+bits{0}
+{}
+
+packed_move::packed_move(square from, square to, piece promote, unsigned flags):
+bits{0}
+{
+    if(from == square_none || to == square_none)
+    {
+        return;
+    }
+
+    bits = from | (to << packed_to_shift);
+
+    // promotion pieces are rook, knight, bishop and queen, stored as 0 to 3,
+    // a move without flags is a promotion only if it reaches the last rank
+    bool last_rank = rank_of(to) == rank_1 || rank_of(to) == rank_8;
+    bool promotion = flags & move_flag_unknown ? promote != piece_none && last_rank : flags & move_flag_promotion;
+
+    if(promotion && promote != piece_none)
+    {
+        bits |= packed_promote_flag | ((promote - piece_rook) << packed_kind_shift);
+        return;
+    }
+
+    packed_kind kind = packed_quiet;
+
+    if(flags & move_flag_unknown)           kind = packed_unknown;
+    else if(flags & move_flag_castle)       kind = packed_castle;
+    else if(flags & move_flag_en_passant)   kind = packed_en_passant;
+    else if(flags & move_flag_double_push)  kind = packed_double_push;
+    else if(flags & move_flag_capture)      kind = packed_capture;
+
+    bits |= kind << packed_kind_shift;
+}
+
+packed_move::packed_move(const move& m):
+packed_move(m.from, m.to, m.promote, m.flags)
+{}
+
+packed_move packed_move::from_lan(std::string_view lan)
+{
+    return packed_move(move::from_lan(lan));
+}
+
+std::string packed_move::to_lan() const
+{
+    return unpack().to_lan();
+}
+
+move packed_move::unpack() const
+{
+    if(is_null())
+    {
+        return move();
+    }
+
+    return move(from(), to(), promote(), flags());
+}
+
+square packed_move::from() const
+{
+    return static_cast<square>(bits & packed_square_mask);
+}
+
+square packed_move::to() const
+{
+    return static_cast<square>((bits >> packed_to_shift) & packed_square_mask);
+}
+
+piece packed_move::promote() const
+{
+    if(!(bits & packed_promote_flag))
+    {
+        return piece_none;
+    }
+
+    return static_cast<piece>(piece_rook + ((bits >> packed_kind_shift) & 0x3));
+}
+
+unsigned packed_move::flags() const
+{
+    if(bits & packed_promote_flag)
+    {
+        bool capture = file_of(from()) != file_of(to());
+        return move_flag_promotion | (capture ? move_flag_capture : move_flag_quiet);
+    }
+
+    switch((bits >> packed_kind_shift) & 0x7)
+    {
+    case packed_quiet:          return move_flag_quiet;
+    case packed_capture:        return move_flag_capture;
+    case packed_double_push:    return move_flag_double_push;
+    case packed_en_passant:     return move_flag_capture | move_flag_en_passant;
+    case packed_castle:         return move_flag_castle;
+    default:                    break;
+    }
+
+    return move_flag_unknown;
+}
+
+bool packed_move::is_null() const
+{
+    return bits == 0;
+}
+
+std::uint16_t packed_move::data() const
+{
+    return bits;
+}
+
 
 }
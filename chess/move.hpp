@@ -3,7 +3,10 @@
 
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <utility>
 
 #include "piece.hpp"
 #include "square.hpp"
@@ -13,9 +16,27 @@ namespace chess
 {
 
 
+/// Move flags.
+///
+/// Describe what kind of move a move is, so that making and undoing it does
+/// not have to inspect the board to find out. Flags can be combined, for
+/// example a promotion can also be a capture. Moves from the move generator
+/// always have their flags set. Other moves have the unknown flag and are
+/// classified by the position when made.
+enum move_flag
+{
+    move_flag_quiet         = 0,
+    move_flag_capture       = 1 << 0,
+    move_flag_double_push   = 1 << 1,
+    move_flag_en_passant    = 1 << 2,
+    move_flag_castle        = 1 << 3,
+    move_flag_promotion     = 1 << 4,
+    move_flag_unknown       = 1 << 5,
+};
+
 /// Chess move.
 ///
-/// Contains all information needed to make a move.
+/// Contains all information needed to make a move, in four bytes.
 struct move
 {
 	/// Null-move.
@@ -32,7 +53,8 @@ struct move
     /// \param from Source square.
     /// \param to Destination square.
     /// \param promote Promotion piece.
-	move(square from, square to, piece promote = piece_queen);
+    /// \param flags Move flags, unknown if not given.
+	move(square from, square to, piece promote = piece_none, unsigned flags = move_flag_unknown);
 
 	// todo: implement
     //static move from_san(std::string_view san, const position& p);
@@ -57,11 +79,154 @@ struct move
 
     bool is_null() const;
 
-    //auto operator<=>(const move&) const = default;
+    /// Move equality.
+    ///
+    /// Moves are equal if they have the same squares and promotion piece.
+    /// Flags are not compared, since they follow from the position.
+    bool operator==(const move& m) const;
 
     square from;
     square to;
     piece promote;
+    std::uint8_t flags;
+};
+
+/// Packed move.
+///
+/// Chess move stored in 16 bits, for move lists, histories and hash table
+/// entries where size matters. Bits 0-5 hold the source square, bits 6-11 the
+/// destination square and bits 12-15 the kind of move. Bit 15 is set for
+/// promotions, in which case bits 12-13 hold the promotion piece (a promotion
+/// is a capture if it changes file). Otherwise bits 12-14 tell if the move is
+/// quiet, a capture, a double push, en passant, castling or of unknown kind.
+/// The null move is stored as all zeros. Unpacked moves have the same flags
+/// as the packed move, so making them does not need to classify them again.
+class packed_move
+{
+public:
+    /// Null-move.
+    packed_move();
+
+    /// Packed move constructor.
+    ///
+    /// \param from Source square.
+    /// \param to Destination square.
+    /// \param promote Promotion piece, or none.
+    /// \param flags Move flags, unknown if not given.
+    packed_move(square from, square to, piece promote = piece_none, unsigned flags = move_flag_unknown);
+
+    /// Pack move.
+    ///
+    /// \param m The move.
+    packed_move(const move& m);
+
+    /// Packed move from Long Algebraic Notation (LAN).
+    ///
+    /// \param lan LAN string.
+    /// \returns Packed move corresponding to LAN.
+    /// \throws Invalid argument if LAN does not denote a move.
+    static packed_move from_lan(std::string_view lan);
+
+    /// Packed move to Long Algebraic Notation (LAN).
+    ///
+    /// \returns LAN of move.
+    std::string to_lan() const;
+
+    /// Unpack move.
+    ///
+    /// \returns The move.
+    move unpack() const;
+
+    square from() const;
+    square to() const;
+    piece promote() const;
+    unsigned flags() const;
+    bool is_null() const;
+
+    /// Raw 16-bit encoding.
+    ///
+    /// \returns Encoded move.
+    std::uint16_t data() const;
+
+    bool operator==(const packed_move&) const = default;
+
+private:
+    std::uint16_t bits;
+};
+
+/// Move list.
+///
+/// Fixed-capacity list of moves that is stored inline (on the stack when used
+/// as a local variable), so filling it does not allocate. No legal position
+/// has more than 218 moves, so the capacity is never exceeded by move
+/// generation.
+class move_list
+{
+public:
+    /// Maximum number of moves.
+    static constexpr std::size_t capacity = 256;
+
+    /// Empty move list.
+    ///
+    /// The underlying storage is left uninitialized.
+    move_list(): count{0} {}
+
+    /// Append move.
+    ///
+    /// Constructs a move at the end of the list.
+    ///
+    /// \param args Move constructor arguments.
+    template<typename... Args>
+    void emplace_back(Args&&... args)
+    {
+        moves[count++] = move(std::forward<Args>(args)...);
+    }
+
+    /// Append move.
+    ///
+    /// \param m The move.
+    void push_back(const move& m)
+    {
+        moves[count++] = m;
+    }
+
+    /// Remove all moves.
+    void clear()
+    {
+        count = 0;
+    }
+
+    /// Shrink list.
+    ///
+    /// \param n New number of moves, at most the current size.
+    void resize(std::size_t n)
+    {
+        count = n;
+    }
+
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    move& operator[](std::size_t i) { return moves[i]; }
+    const move& operator[](std::size_t i) const { return moves[i]; }
+
+    move& front() { return moves[0]; }
+    const move& front() const { return moves[0]; }
+    move& back() { return moves[count - 1]; }
+    const move& back() const { return moves[count - 1]; }
+
+    move* begin() { return moves.data(); }
+    move* end() { return moves.data() + count; }
+    const move* begin() const { return moves.data(); }
+    const move* end() const { return moves.data() + count; }
+
+private:
+    // moves are trivially copyable, so the union lets the storage stay uninitialized
+    union
+    {
+        std::array<move, capacity> moves;
+    };
+    std::size_t count;
 };
 
 /// Chess move undo.
@@ -76,6 +241,7 @@ struct undo
     std::array<bool, sides> kingside_castle;
     std::array<bool, sides> queenside_castle;
     int halfmove_clock;
+    unsigned flags;
 };
 
 
@@ -0,0 +1,97 @@
+#include <cstddef>
+
+#include "move.hpp"
+#include "position.hpp"
+#include "picker.hpp"
+
+
+namespace chess
+{
+
+
+move_picker::move_picker(const position& p, const move& hash_move):
+p{p},
+hash_move{hash_move},
+current{stage_hash},
+moves(),
+index{0}
+{}
+
+move move_picker::next()
+{
+    switch(current)
+    {
+    case stage_hash:
+        current = stage_captures_generate;
+
+        // the hash move might be from another position, so only the moves to
+        // its destination square are generated to verify it
+        if(!hash_move.is_null())
+        {
+            bitboard targets = square_set(hash_move.to);
+
+            // en passant is generated by the square of the captured pawn
+            if(hash_move.to == p.get_en_passant())
+            {
+                targets |= square_set(cat_coords(file_of(hash_move.to), side_rank(p.get_turn(), rank_5)));
+            }
+
+            moves.clear();
+            generate_targets(p, moves, targets);
+
+            for(const move& m: moves)
+            {
+                if(m == hash_move)
+                {
+                    // return the generated move, which has its flags set
+                    hash_move = m;
+                    return m;
+                }
+            }
+
+            hash_move = move();
+        }
+        [[fallthrough]];
+
+    case stage_captures_generate:
+        moves.clear();
+        generate_captures(p, moves);
+        index = 0;
+        current = stage_captures;
+        [[fallthrough]];
+
+    case stage_captures:
+        while(index < moves.size())
+        {
+            const move& m = moves[index++];
+            if(m != hash_move) return m;
+        }
+        current = stage_quiets_generate;
+        [[fallthrough]];
+
+    case stage_quiets_generate:
+        moves.clear();
+        generate_quiets(p, moves);
+        index = 0;
+        current = stage_quiets;
+        [[fallthrough]];
+
+    case stage_quiets:
+        while(index < moves.size())
+        {
+            const move& m = moves[index++];
+            if(m != hash_move) return m;
+        }
+        current = stage_done;
+        [[fallthrough]];
+
+    case stage_done:
+    default:
+        break;
+    }
+
+    return move();
+}
+
+
+}
@@ -0,0 +1,63 @@
+#ifndef CHESS_PICKER_HPP
+#define CHESS_PICKER_HPP
+
+
+#include <cstddef>
+
+#include "move.hpp"
+#include "position.hpp"
+
+
+namespace chess
+{
+
+
+/// Staged move picker.
+///
+/// Yields the legal moves of a position one at a time, in stages: first the
+/// hash move (if given and legal), then captures and promotions, then quiet
+/// moves. A stage is only generated once the moves of the previous stage are
+/// exhausted, so a search that cuts off early never pays for generating
+/// quiet moves.
+class move_picker
+{
+public:
+    /// Move picker.
+    ///
+    /// The position must outlive the picker and must not be modified while
+    /// picking.
+    ///
+    /// \param p The position.
+    /// \param hash_move Move to try first, for example from a transposition table.
+    move_picker(const position& p, const move& hash_move = move());
+
+    /// Next move.
+    ///
+    /// Returns the next legal move, generating the next stage if necessary.
+    ///
+    /// \returns The move, or a null move when all moves have been picked.
+    move next();
+
+private:
+    enum stage
+    {
+        stage_hash,
+        stage_captures_generate,
+        stage_captures,
+        stage_quiets_generate,
+        stage_quiets,
+        stage_done,
+    };
+
+    const position& p;
+    move hash_move;
+    stage current;
+    move_list moves;
+    std::size_t index;
+};
+
+
+}
+
+
+#endif
@@ -2,6 +2,7 @@
 #define CHESS_PIECE_HPP
 
 
+#include <cstdint>
 #include <utility>
 #include <string>
 #include <stdexcept>
@@ -17,7 +18,8 @@ namespace chess
 /// Pieces in chess.
 ///
 /// In some places, a none-piece is useful (for example for empty board squares).
-enum piece
+/// Stored in a byte, like squares.
+enum piece : std::int8_t
 {
     piece_pawn,
     piece_rook,
@@ -9,6 +9,7 @@
 #include "position.hpp"
 #include "zobrist.hpp"
 #include "attack.hpp"
+#include "probe.hpp"
 
 
 namespace chess
@@ -58,9 +59,9 @@ repetitions{1}
 }
 
 
-position position::from_fen(const std::string& fen)
+position position::from_fen(std::string_view fen)
 {
-	std::istringstream in(fen);
+	std::istringstream in{std::string(fen)};
     return from_fen(in);
 }
 
@@ -239,38 +240,91 @@ std::string position::to_fen() const
 	return fen_stream.str();
 }
 
+unsigned position::move_flags(const move& m) const
+{
+    auto [side, piece] = b.get(m.from);
+    unsigned flags = move_flag_quiet;
+
+    if(b.get(m.to).second != piece_none)
+    {
+        flags |= move_flag_capture;
+    }
+
+    if(piece == piece_pawn)
+    {
+        if(rank_of(m.from) == side_rank(side, rank_2) && rank_of(m.to) == side_rank(side, rank_4))
+        {
+            flags |= move_flag_double_push;
+        }
+        else if(m.to == en_passant)
+        {
+            flags |= move_flag_capture | move_flag_en_passant;
+        }
+        else if(rank_of(m.to) == side_rank(side, rank_8) && m.promote != piece_none)
+        {
+            flags |= move_flag_promotion;
+        }
+    }
+    else if(piece == piece_king)
+    {
+        rank rank_first = side_rank(side, rank_1);
+
+        if(m.from == cat_coords(file_e, rank_first) && (m.to == cat_coords(file_g, rank_first) || m.to == cat_coords(file_c, rank_first)))
+        {
+            flags |= move_flag_castle;
+        }
+    }
+
+    return flags;
+}
+
 undo position::make_move(const move& m)
 {
-	piece capture = b.get(m.to).second;
-    undo u{capture, en_passant, kingside_castle, queenside_castle, halfmove_clock};
+    CHESS_PROBE(make_move);
+
+    unsigned flags = m.flags & move_flag_unknown ? move_flags(m) : m.flags;
+
+    // only a capture needs the destination square looked up, en passant captures
+    // are restored from the en passant square
+    piece capture = (flags & (move_flag_capture | move_flag_en_passant)) == move_flag_capture ? b.get(m.to).second : piece_none;
+    undo u{capture, en_passant, kingside_castle, queenside_castle, halfmove_clock, flags};
 
     auto [side, piece] = b.get(m.from);
     square ep = en_passant;
 
     b.set(m.from, side_none, piece_none);
-
-    if(m.promote != piece_none) b.set(m.to, side, m.promote);
-    else b.set(m.to, side, piece);
+    b.set(m.to, side, flags & move_flag_promotion ? m.promote : piece);
 
     en_passant = square_none;
     if(ep != square_none) zobrist_hash ^= zobrist_en_passant_key(file_of(ep));
 
-    if(piece == piece_pawn)
+    if(flags & move_flag_double_push)
     {
-        if(rank_of(m.from) == side_rank(side, rank_2) && rank_of(m.to) == side_rank(side, rank_4))
+        en_passant = cat_coords(file_of(m.from), side_rank(side, rank_3));
+        zobrist_hash ^= zobrist_en_passant_key(file_of(en_passant));
+    }
+    else if(flags & move_flag_en_passant)
+    {
+        square ep_capture = cat_coords(file_of(ep), side_rank(side, rank_5));
+        b.set(ep_capture, side_none, piece_none);
+    }
+    else if(flags & move_flag_castle)
+    {
+        rank rank_first = side_rank(side, rank_1);
+
+        if(file_of(m.to) == file_g)
         {
-            // double push
-            en_passant = cat_coords(file_of(m.from), side_rank(side, rank_3));
-            zobrist_hash ^= zobrist_en_passant_key(file_of(en_passant));
+            b.set(cat_coords(file_h, rank_first), side_none, piece_none);
+            b.set(cat_coords(file_f, rank_first), side, piece_rook);
         }
-        else if(m.to == ep)
+        else
         {
-            // en passant capture
-            square ep_capture = cat_coords(file_of(ep), side_rank(side, rank_5));
-            b.set(ep_capture, side_none, piece_none);
+            b.set(cat_coords(file_a, rank_first), side_none, piece_none);
+            b.set(cat_coords(file_d, rank_first), side, piece_rook);
         }
     }
-    else if(piece == piece_king)
+
+    if(piece == piece_king)
     {
         if(kingside_castle[side])
         {
@@ -282,22 +336,6 @@ undo position::make_move(const move& m)
             queenside_castle[side] = false;
             zobrist_hash ^= zobrist_queenside_castle_key(side);
         }
-        
-        rank rank_first = side_rank(side, rank_1);
-
-        if(m.from == cat_coords(file_e, rank_first))
-        {
-            if(m.to == cat_coords(file_g, rank_first))
-            {
-                b.set(cat_coords(file_h, rank_first), side_none, piece_none);
-                b.set(cat_coords(file_f, rank_first), side, piece_rook);
-            }
-            else if(m.to == cat_coords(file_c, rank_first))
-            {
-                b.set(cat_coords(file_a, rank_first), side_none, piece_none);
-                b.set(cat_coords(file_d, rank_first), side, piece_rook);
-            }
-        }
     }
 
     // todo: these (and en passant) should only be updated if they changed from the previous move
@@ -324,7 +362,7 @@ undo position::make_move(const move& m)
         zobrist_hash ^= zobrist_kingside_castle_key(side_black);
     }
 
-    if(piece == piece_pawn || capture != piece_none)
+    if(piece == piece_pawn || flags & move_flag_capture)
     {
         halfmove_clock = 0;
     }
@@ -342,12 +380,12 @@ undo position::make_move(const move& m)
 
 void position::undo_move(const move& m, const undo& u)
 {
+    CHESS_PROBE(undo_move);
+
     auto [side, piece] = b.get(m.to);
 
-    b.set(m.from, side, piece);
-    b.set(m.to, side_none, piece_none);
-    if(u.capture != piece_none) b.set(m.to, opponent(side), u.capture);
-    if(m.promote != piece_none) b.set(m.from, side, piece_pawn);
+    b.set(m.from, side, u.flags & move_flag_promotion ? piece_pawn : piece);
+    b.set(m.to, u.capture != piece_none ? opponent(side) : side_none, u.capture);
 
     if(en_passant != square_none) zobrist_hash ^= zobrist_en_passant_key(file_of(en_passant));
     if(u.en_passant != square_none) zobrist_hash ^= zobrist_en_passant_key(file_of(u.en_passant));
@@ -374,30 +412,24 @@ void position::undo_move(const move& m, const undo& u)
         zobrist_hash ^= zobrist_queenside_castle_key(side_black);
     }
 
-    if(piece == piece_pawn)
+    if(u.flags & move_flag_en_passant)
     {
-        if(m.to == u.en_passant)
-        {
-            square ep_capture = cat_coords(file_of(u.en_passant), side_rank(side, rank_5));
-            b.set(ep_capture, opponent(side), piece_pawn);
-        }
+        square ep_capture = cat_coords(file_of(u.en_passant), side_rank(side, rank_5));
+        b.set(ep_capture, opponent(side), piece_pawn);
     }
-    else if(piece == piece_king)
+    else if(u.flags & move_flag_castle)
     {
         rank rank_first = side_rank(side, rank_1);
 
-        if(m.from == cat_coords(file_e, rank_first))
+        if(file_of(m.to) == file_g)
         {
-            if(m.to == cat_coords(file_g, rank_first))
-            {
-                b.set(cat_coords(file_h, rank_first), side, piece_rook);
-                b.set(cat_coords(file_f, rank_first), side_none, piece_none);
-            }
-            else if(m.to == cat_coords(file_c, side_rank(side, rank_1)))
-            {
-                b.set(cat_coords(file_a, rank_first), side, piece_rook);
-                b.set(cat_coords(file_d, rank_first), side_none, piece_none);
-            }
+            b.set(cat_coords(file_h, rank_first), side, piece_rook);
+            b.set(cat_coords(file_f, rank_first), side_none, piece_none);
+        }
+        else
+        {
+            b.set(cat_coords(file_a, rank_first), side, piece_rook);
+            b.set(cat_coords(file_d, rank_first), side_none, piece_none);
         }
     }
 
@@ -409,46 +441,198 @@ void position::undo_move(const move& m, const undo& u)
 
 position position::copy_move(const move& m) const
 {
+    CHESS_PROBE(copy_move);
+
     position p = *this;
     p.make_move(m);
     return p;
 }
 
+// Subset of pawns that can move in a direction without leaving a pin.
+template<direction d>
+static bitboard unpinned_set(bitboard pawns, bitboard pinned, square king)
+{
+    bitboard movable = pawns & ~pinned;
+    bitboard pins = pawns & pinned;
+
+    while(pins)
+    {
+        square from = set_first(pins);
+        pins = set_erase(pins, from);
+        if(set_shift<d>(square_set(from)) & line_set(king, from)) movable = set_insert(movable, from);
+    }
+
+    return movable;
+}
+
 std::vector<move> position::moves() const
 {
-    std::vector<move> moves;
+    CHESS_PROBE(moves);
+
+    move_list moves;
+    generate(moves);
+    CHESS_PROBE_VALUE(moves, moves.size());
+    return std::vector<move>(moves.begin(), moves.end());
+}
+
+void generate(const position& p, move_list& moves)
+{
+    p.generate(moves);
+}
+
+void generate_captures(const position& p, move_list& moves)
+{
+    p.generate(moves, p.b.side_set(opponent(p.turn)), universal_set);
+}
+
+void generate_quiets(const position& p, move_list& moves)
+{
+    p.generate(moves, ~p.b.side_set(opponent(p.turn)), empty_set);
+}
+
+void generate_evasions(const position& p, move_list& moves)
+{
+    p.generate_evasions(moves);
+}
+
+void generate_targets(const position& p, move_list& moves, bitboard targets)
+{
+    p.generate(moves, targets, targets);
+}
+
+void generate_pseudo_legal(const position& p, move_list& moves)
+{
+    p.generate(moves, universal_set, universal_set, false);
+}
+
+void position::generate(move_list& moves, bitboard targets, bitboard promote_targets, bool legal) const
+{
+    CHESS_PROBE(generate);
+    std::size_t size = moves.size();
+
+    if(turn == side_white)
+    {
+        legal ? generate<side_white, true>(moves, targets, promote_targets) : generate<side_white, false>(moves, targets, promote_targets);
+    }
+    else
+    {
+        legal ? generate<side_black, true>(moves, targets, promote_targets) : generate<side_black, false>(moves, targets, promote_targets);
+    }
+
+    CHESS_PROBE_VALUE(generate, moves.size() - size);
+}
+
+void position::generate_evasions(move_list& moves) const
+{
+    CHESS_PROBE(generate);
+    std::size_t size = moves.size();
+
+    if(turn == side_white)
+    {
+        generate<side_white, true, true>(moves, universal_set, universal_set);
+    }
+    else
+    {
+        generate<side_black, true, true>(moves, universal_set, universal_set);
+    }
+
+    CHESS_PROBE_VALUE(generate, moves.size() - size);
+}
+
+template<side s, bool legal, bool evasions>
+void position::generate(move_list& moves, bitboard targets, bitboard promote_targets) const
+{
+    // directions, ranks and castling squares are constants for each side
+    constexpr direction up = forwards(s);
+    constexpr direction down = forwards(opponent(s));
+    constexpr direction up_east = static_cast<direction>(up + direction_e);
+    constexpr direction up_west = static_cast<direction>(up + direction_w);
+    constexpr direction down_east = static_cast<direction>(down + direction_e);
+    constexpr direction down_west = static_cast<direction>(down + direction_w);
+
+    constexpr bitboard double_push_rank = rank_set(side_rank(s, rank_3));
+    constexpr bitboard promote_from_rank = rank_set(side_rank(s, rank_7));
+    constexpr bitboard promote_rank = rank_set(side_rank(s, rank_8));
+
+    constexpr square castle_b = cat_coords(file_b, side_rank(s, rank_1));
+    constexpr square castle_c = cat_coords(file_c, side_rank(s, rank_1));
+    constexpr square castle_d = cat_coords(file_d, side_rank(s, rank_1));
+    constexpr square castle_f = cat_coords(file_f, side_rank(s, rank_1));
+    constexpr square castle_g = cat_coords(file_g, side_rank(s, rank_1));
 
     bitboard occupied = b.occupied_set();
     
-    bitboard pawns = b.piece_set(piece_pawn, turn);
-    bitboard rooks = b.piece_set(piece_rook, turn);
-    bitboard knights = b.piece_set(piece_knight, turn);
-    bitboard bishops = b.piece_set(piece_bishop, turn);
-    bitboard queens = b.piece_set(piece_queen, turn);
-    bitboard kings = b.piece_set(piece_king, turn);
+    bitboard pawns = b.piece_set(piece_pawn, s);
+    bitboard rooks = b.piece_set(piece_rook, s);
+    bitboard knights = b.piece_set(piece_knight, s);
+    bitboard bishops = b.piece_set(piece_bishop, s);
+    bitboard queens = b.piece_set(piece_queen, s);
+    bitboard kings = b.piece_set(piece_king, s);
     
-    bitboard attack_mask = ~b.side_set(turn);
-    bitboard capture_mask = b.side_set(opponent(turn));
-    bitboard ep_mask = 0;
-    if(en_passant != square_none) ep_mask = square_set(en_passant);
+    bitboard attack_mask = ~b.side_set(s);
+    bitboard capture_mask = b.side_set(opponent(s));
+
+    // checkers and pinned pieces (positions without a king have neither)
+    // pseudo-legal moves ignore both, and are checked by is_legal() instead
+    square king = set_first(kings);
+    bitboard checkers = 0;
+    bitboard pinned = 0;
+    bitboard snipers = 0;
+
+    if(legal && kings)
+    {
+        checkers = b.attackers_to<opponent(s)>(king, occupied);
+        snipers = (rook_attack_set(king, empty_set) & (b.piece_set(piece_rook, opponent(s)) | b.piece_set(piece_queen, opponent(s))))
+                | (bishop_attack_set(king, empty_set) & (b.piece_set(piece_bishop, opponent(s)) | b.piece_set(piece_queen, opponent(s))));
+    }
+
+    // evasions are the king moves and the moves into the check mask below,
+    // and there are none when not checked
+    if(evasions && !checkers) return;
+
+    while(snipers)
+    {
+        square sniper = set_first(snipers);
+        snipers = set_erase(snipers, sniper);
+        bitboard blockers = between_set(king, sniper) & occupied;
+        if(set_cardinality(blockers) == 1) pinned |= blockers & ~capture_mask;
+    }
+
+    // when checked, other pieces must capture the checker or block the check
+    // and when double checked, only the king can move
+    bitboard check_mask = universal_set;
+    if(checkers) check_mask = between_set(king, set_first(checkers)) | checkers;
+    if(set_cardinality(checkers) > 1)
+    {
+        check_mask = empty_set;
+        pawns = rooks = knights = bishops = queens = empty_set;
+    }
+
+    // promotions are selected separately from other moves
+    bitboard pawn_mask = ((targets & ~promote_rank) | (promote_targets & promote_rank)) & check_mask;
 
     // pawn moves
-    bitboard single_push_tos = set_shift(pawns, forwards(turn)) & ~occupied;
-    bitboard single_push_froms = set_shift(single_push_tos, forwards(opponent(turn)));
-    bitboard double_push_tos = set_shift(single_push_tos & rank_set(side_rank(turn, rank_3)), forwards(turn)) & ~occupied;
-    bitboard double_push_froms = set_shift(set_shift(double_push_tos, forwards(opponent(turn))), forwards(opponent(turn)));
-
-    bitboard attack_east_tos = set_shift(pawns, static_cast<direction>(forwards(turn) + direction_e)) & (capture_mask | ep_mask);
-    bitboard attack_east_froms = set_shift(attack_east_tos, static_cast<direction>(forwards(opponent(turn)) + direction_w));
-    bitboard attack_west_tos = set_shift(pawns, static_cast<direction>(forwards(turn) + direction_w)) & (capture_mask | ep_mask);
-    bitboard attack_west_froms = set_shift(attack_west_tos, static_cast<direction>(forwards(opponent(turn)) + direction_e));
+    bitboard push_pawns = unpinned_set<up>(pawns, pinned, king);
+    bitboard east_pawns = unpinned_set<up_east>(pawns, pinned, king);
+    bitboard west_pawns = unpinned_set<up_west>(pawns, pinned, king);
+
+    bitboard single_push_tos = set_shift<up>(push_pawns) & ~occupied;
+    bitboard double_push_tos = set_shift<up>(single_push_tos & double_push_rank) & ~occupied & pawn_mask;
+    single_push_tos &= pawn_mask;
+    bitboard single_push_froms = set_shift<down>(single_push_tos);
+    bitboard double_push_froms = set_shift<down>(set_shift<down>(double_push_tos));
+
+    bitboard attack_east_tos = set_shift<up_east>(east_pawns) & capture_mask & pawn_mask;
+    bitboard attack_east_froms = set_shift<down_west>(attack_east_tos);
+    bitboard attack_west_tos = set_shift<up_west>(west_pawns) & capture_mask & pawn_mask;
+    bitboard attack_west_froms = set_shift<down_east>(attack_west_tos);
     
-    bitboard promote_push_tos = single_push_tos & rank_set(side_rank(turn, rank_8));
-    bitboard promote_push_froms = single_push_froms & rank_set(side_rank(turn, rank_7));
-    bitboard promote_east_tos = attack_east_tos & rank_set(side_rank(turn, rank_8));
-    bitboard promote_east_froms = attack_east_froms & rank_set(side_rank(turn, rank_7));
-    bitboard promote_west_tos = attack_west_tos & rank_set(side_rank(turn, rank_8));
-    bitboard promote_west_froms = attack_west_froms & rank_set(side_rank(turn, rank_7));;
+    bitboard promote_push_tos = single_push_tos & promote_rank;
+    bitboard promote_push_froms = single_push_froms & promote_from_rank;
+    bitboard promote_east_tos = attack_east_tos & promote_rank;
+    bitboard promote_east_froms = attack_east_froms & promote_from_rank;
+    bitboard promote_west_tos = attack_west_tos & promote_rank;
+    bitboard promote_west_froms = attack_west_froms & promote_from_rank;
 
     single_push_tos ^= promote_push_tos;
     single_push_froms ^= promote_push_froms;
@@ -457,26 +641,54 @@ std::vector<move> position::moves() const
     attack_west_tos ^= promote_west_tos;
     attack_west_froms ^= promote_west_froms;
 
-    setwise_moves(single_push_froms, single_push_tos, piece_none, moves);
-    setwise_moves(double_push_froms, double_push_tos, piece_none, moves);
+    setwise_moves(single_push_froms, single_push_tos, piece_none, move_flag_quiet, moves);
+    setwise_moves(double_push_froms, double_push_tos, piece_none, move_flag_double_push, moves);
     
-    setwise_moves(attack_east_froms, attack_east_tos, piece_none, moves);
-    setwise_moves(attack_west_froms, attack_west_tos, piece_none, moves);
+    setwise_moves(attack_east_froms, attack_east_tos, piece_none, move_flag_capture, moves);
+    setwise_moves(attack_west_froms, attack_west_tos, piece_none, move_flag_capture, moves);
     
-    setwise_moves(promote_push_froms, promote_push_tos, piece_rook, moves);
-    setwise_moves(promote_push_froms, promote_push_tos, piece_knight, moves);
-    setwise_moves(promote_push_froms, promote_push_tos, piece_bishop, moves);
-    setwise_moves(promote_push_froms, promote_push_tos, piece_queen, moves);
+    setwise_moves(promote_push_froms, promote_push_tos, piece_rook, move_flag_promotion, moves);
+    setwise_moves(promote_push_froms, promote_push_tos, piece_knight, move_flag_promotion, moves);
+    setwise_moves(promote_push_froms, promote_push_tos, piece_bishop, move_flag_promotion, moves);
+    setwise_moves(promote_push_froms, promote_push_tos, piece_queen, move_flag_promotion, moves);
+
+    setwise_moves(promote_east_froms, promote_east_tos, piece_rook, move_flag_promotion | move_flag_capture, moves);
+    setwise_moves(promote_east_froms, promote_east_tos, piece_knight, move_flag_promotion | move_flag_capture, moves);
+    setwise_moves(promote_east_froms, promote_east_tos, piece_bishop, move_flag_promotion | move_flag_capture, moves);
+    setwise_moves(promote_east_froms, promote_east_tos, piece_queen, move_flag_promotion | move_flag_capture, moves);
+
+    setwise_moves(promote_west_froms, promote_west_tos, piece_rook, move_flag_promotion | move_flag_capture, moves);
+    setwise_moves(promote_west_froms, promote_west_tos, piece_knight, move_flag_promotion | move_flag_capture, moves);
+    setwise_moves(promote_west_froms, promote_west_tos, piece_bishop, move_flag_promotion | move_flag_capture, moves);
+    setwise_moves(promote_west_froms, promote_west_tos, piece_queen, move_flag_promotion | move_flag_capture, moves);
+
+    // en passant can uncover a check along the rank of both pawns, so test it
+    // by removing both pawns from the occupancy
+    // it is selected by the square of the captured pawn
+    square ep_capture = en_passant != square_none ? cat_coords(file_of(en_passant), side_rank(s, rank_5)) : square_none;
+
+    if(en_passant != square_none && set_contains(targets, ep_capture))
+    {
+        bitboard ep_bb = square_set(en_passant);
+        bitboard froms = (pawn_east_attack_set<opponent(s)>(ep_bb) | pawn_west_attack_set<opponent(s)>(ep_bb)) & pawns;
 
-    setwise_moves(promote_east_froms, promote_east_tos, piece_rook, moves);
-    setwise_moves(promote_east_froms, promote_east_tos, piece_knight, moves);
-    setwise_moves(promote_east_froms, promote_east_tos, piece_bishop, moves);
-    setwise_moves(promote_east_froms, promote_east_tos, piece_queen, moves);
+        while(froms)
+        {
+            square from = set_first(froms);
+            froms = set_erase(froms, from);
+            bitboard ep_occupied = (occupied ^ square_set(from) ^ square_set(ep_capture)) | ep_bb;
+
+            if(!legal || !kings || !(b.attackers_to<opponent(s)>(king, ep_occupied) & ~square_set(ep_capture)))
+            {
+                moves.emplace_back(from, en_passant, piece_none, move_flag_capture | move_flag_en_passant);
+            }
+        }
+    }
 
-    setwise_moves(promote_west_froms, promote_west_tos, piece_rook, moves);
-    setwise_moves(promote_west_froms, promote_west_tos, piece_knight, moves);
-    setwise_moves(promote_west_froms, promote_west_tos, piece_bishop, moves);
-    setwise_moves(promote_west_froms, promote_west_tos, piece_queen, moves);
+    // pinned pieces can only move along the line through the king and the pinner
+    // pinned knights can not move at all
+    attack_mask &= check_mask & targets;
+    knights &= ~pinned;
 
     // rook moves
     while(rooks)
@@ -484,7 +696,8 @@ std::vector<move> position::moves() const
         square from = set_first(rooks);
         rooks = set_erase(rooks, from);
         bitboard attacks = rook_attack_set(from, occupied) & attack_mask;
-        piecewise_moves(from, attacks, piece_none, moves);
+        if(set_contains(pinned, from)) attacks &= line_set(king, from);
+        piecewise_moves(from, attacks, capture_mask, moves);
     }
 
     // knight moves
@@ -493,7 +706,7 @@ std::vector<move> position::moves() const
         square from = set_first(knights);
         knights = set_erase(knights, from);
         bitboard attacks = knight_attack_set(from) & attack_mask;
-        piecewise_moves(from, attacks, piece_none, moves);
+        piecewise_moves(from, attacks, capture_mask, moves);
     }
 
     // bishop moves
@@ -502,7 +715,8 @@ std::vector<move> position::moves() const
         square from = set_first(bishops);
         bishops = set_erase(bishops, from);
         bitboard attacks = bishop_attack_set(from, occupied) & attack_mask;
-        piecewise_moves(from, attacks, piece_none, moves);
+        if(set_contains(pinned, from)) attacks &= line_set(king, from);
+        piecewise_moves(from, attacks, capture_mask, moves);
     }
 
     // queen moves
@@ -511,62 +725,345 @@ std::vector<move> position::moves() const
         square from = set_first(queens);
         queens = set_erase(queens, from);
         bitboard attacks = (rook_attack_set(from, occupied) | bishop_attack_set(from, occupied)) & attack_mask;
-        piecewise_moves(from, attacks, piece_none, moves);
+        if(set_contains(pinned, from)) attacks &= line_set(king, from);
+        piecewise_moves(from, attacks, capture_mask, moves);
     }
 
     // king moves
-    if(kingside_castle[turn])
+    // when not checked, no slider ray passes through the king, so the attack
+    // map (if maintained) tells exactly which squares the king can go to
+    bool attack_map = legal && b.has_attack_maps() && !checkers;
+    bitboard attacked = attack_map ? b.attack_set(opponent(s)) : empty_set;
+
+    if(kingside_castle[s] && !checkers && set_contains(targets, castle_g))
     {
-        square from = set_first(kings);
-        square to = cat_coords(file_g, rank_of(from));
-        bitboard path = kings;
-        path |= set_shift(path, direction_e);
-        path |= set_shift(path, direction_e);
-        bitboard between = path & ~kings;
+        constexpr bitboard between = square_set(castle_f) | square_set(castle_g);
+        bool safe = !legal || (attack_map ? !(between & attacked) : !b.attackers_to<opponent(s)>(castle_f, occupied) && !b.attackers_to<opponent(s)>(castle_g, occupied));
 
-        if(!(between & occupied) && !(path & b.attack_set(opponent(turn))))
+        if(!(between & occupied) && safe)
         {
-            moves.emplace_back(from, to, piece_none);
+            moves.emplace_back(king, castle_g, piece_none, move_flag_castle);
         }
     }
-    if(queenside_castle[turn])
+    if(queenside_castle[s] && !checkers && set_contains(targets, castle_c))
     {
-        square from = set_first(kings);
-        square to = cat_coords(file_c, rank_of(from));
-        bitboard path = kings;
-        path |= set_shift(path, direction_w);
-        path |= set_shift(path, direction_w);
-        bitboard between = set_shift(path, direction_w);
+        constexpr bitboard between = square_set(castle_b) | square_set(castle_c) | square_set(castle_d);
+        constexpr bitboard path = square_set(castle_c) | square_set(castle_d);
+        bool safe = !legal || (attack_map ? !(path & attacked) : !b.attackers_to<opponent(s)>(castle_d, occupied) && !b.attackers_to<opponent(s)>(castle_c, occupied));
 
-        if(!(between & occupied) && !(path & b.attack_set(opponent(turn))))
+        if(!(between & occupied) && safe)
         {
-            moves.emplace_back(from, to, piece_none);
+            moves.emplace_back(king, castle_c, piece_none, move_flag_castle);
         }
     }
-    while(kings)
+
+    // the king can not hide behind itself from a slider, so remove it from the occupancy
+    bitboard king_tos = kings ? king_attack_set(king) & ~b.side_set(s) & targets : empty_set;
+    bitboard king_occupied = occupied ^ kings;
+
+    if(attack_map || !legal)
     {
-        square from = set_first(kings);
-        kings = set_erase(kings, from);
-        bitboard attacks = king_attack_set(from) & attack_mask;
-        piecewise_moves(from, attacks, piece_none, moves);
+        piecewise_moves(king, legal ? king_tos & ~attacked : king_tos, capture_mask, moves);
+        king_tos = empty_set;
     }
 
-    // remove illegal moves
-    side player = turn;
-    int n = 0;
-    for(move& m: moves)
+    while(king_tos)
     {
-        position p = copy_move(m);;
+        square to = set_first(king_tos);
+        king_tos = set_erase(king_tos, to);
 
-        if(!(p.b.attack_set(opponent(player)) & p.b.piece_set(piece_king, player)))
+        if(!b.attackers_to<opponent(s)>(to, king_occupied))
         {
-            moves[n++] = m;
+            moves.emplace_back(king, to, piece_none, set_contains(capture_mask, to) ? move_flag_capture : move_flag_quiet);
         }
     }
+}
+
+int position::count_legal_moves() const
+{
+    return turn == side_white ? count_legal_moves<side_white>() : count_legal_moves<side_black>();
+}
+
+template<side s>
+int position::count_legal_moves() const
+{
+    // same masks as legal generation, but destinations are counted instead of listed
+    constexpr direction up = forwards(s);
+    constexpr direction up_east = static_cast<direction>(up + direction_e);
+    constexpr direction up_west = static_cast<direction>(up + direction_w);
+
+    constexpr bitboard double_push_rank = rank_set(side_rank(s, rank_3));
+    constexpr bitboard promote_rank = rank_set(side_rank(s, rank_8));
+
+    constexpr square castle_b = cat_coords(file_b, side_rank(s, rank_1));
+    constexpr square castle_c = cat_coords(file_c, side_rank(s, rank_1));
+    constexpr square castle_d = cat_coords(file_d, side_rank(s, rank_1));
+    constexpr square castle_f = cat_coords(file_f, side_rank(s, rank_1));
+    constexpr square castle_g = cat_coords(file_g, side_rank(s, rank_1));
+
+    bitboard occupied = b.occupied_set();
+
+    bitboard pawns = b.piece_set(piece_pawn, s);
+    bitboard rooks = b.piece_set(piece_rook, s);
+    bitboard knights = b.piece_set(piece_knight, s);
+    bitboard bishops = b.piece_set(piece_bishop, s);
+    bitboard queens = b.piece_set(piece_queen, s);
+    bitboard kings = b.piece_set(piece_king, s);
+
+    bitboard attack_mask = ~b.side_set(s);
+    bitboard capture_mask = b.side_set(opponent(s));
+
+    square king = set_first(kings);
+    bitboard checkers = 0;
+    bitboard pinned = 0;
+    bitboard snipers = 0;
+
+    if(kings)
+    {
+        checkers = b.attackers_to<opponent(s)>(king, occupied);
+        snipers = (rook_attack_set(king, empty_set) & (b.piece_set(piece_rook, opponent(s)) | b.piece_set(piece_queen, opponent(s))))
+                | (bishop_attack_set(king, empty_set) & (b.piece_set(piece_bishop, opponent(s)) | b.piece_set(piece_queen, opponent(s))));
+    }
+
+    while(snipers)
+    {
+        square sniper = set_first(snipers);
+        snipers = set_erase(snipers, sniper);
+        bitboard blockers = between_set(king, sniper) & occupied;
+        if(set_cardinality(blockers) == 1) pinned |= blockers & ~capture_mask;
+    }
+
+    bitboard check_mask = universal_set;
+    if(checkers) check_mask = between_set(king, set_first(checkers)) | checkers;
+    if(set_cardinality(checkers) > 1)
+    {
+        check_mask = empty_set;
+        pawns = rooks = knights = bishops = queens = empty_set;
+    }
+
+    int count = 0;
+
+    // pawn moves, each promotion counts as four moves
+    bitboard single_push_tos = set_shift<up>(unpinned_set<up>(pawns, pinned, king)) & ~occupied;
+    bitboard double_push_tos = set_shift<up>(single_push_tos & double_push_rank) & ~occupied & check_mask;
+    bitboard attack_east_tos = set_shift<up_east>(unpinned_set<up_east>(pawns, pinned, king)) & capture_mask & check_mask;
+    bitboard attack_west_tos = set_shift<up_west>(unpinned_set<up_west>(pawns, pinned, king)) & capture_mask & check_mask;
+    single_push_tos &= check_mask;
+
+    count += set_cardinality(single_push_tos & ~promote_rank) + 4 * set_cardinality(single_push_tos & promote_rank);
+    count += set_cardinality(double_push_tos);
+    count += set_cardinality(attack_east_tos & ~promote_rank) + 4 * set_cardinality(attack_east_tos & promote_rank);
+    count += set_cardinality(attack_west_tos & ~promote_rank) + 4 * set_cardinality(attack_west_tos & promote_rank);
+
+    // en passant is rare, so it is tested like in generation
+    if(en_passant != square_none)
+    {
+        square ep_capture = cat_coords(file_of(en_passant), side_rank(s, rank_5));
+        bitboard ep_bb = square_set(en_passant);
+        bitboard froms = (pawn_east_attack_set<opponent(s)>(ep_bb) | pawn_west_attack_set<opponent(s)>(ep_bb)) & pawns;
+
+        while(froms)
+        {
+            square from = set_first(froms);
+            froms = set_erase(froms, from);
+            bitboard ep_occupied = (occupied ^ square_set(from) ^ square_set(ep_capture)) | ep_bb;
+
+            if(!kings || !(b.attackers_to<opponent(s)>(king, ep_occupied) & ~square_set(ep_capture)))
+            {
+                count++;
+            }
+        }
+    }
+
+    attack_mask &= check_mask;
+    knights &= ~pinned;
+
+    while(rooks)
+    {
+        square from = set_first(rooks);
+        rooks = set_erase(rooks, from);
+        bitboard attacks = rook_attack_set(from, occupied) & attack_mask;
+        if(set_contains(pinned, from)) attacks &= line_set(king, from);
+        count += set_cardinality(attacks);
+    }
+
+    while(knights)
+    {
+        square from = set_first(knights);
+        knights = set_erase(knights, from);
+        count += set_cardinality(knight_attack_set(from) & attack_mask);
+    }
+
+    while(bishops)
+    {
+        square from = set_first(bishops);
+        bishops = set_erase(bishops, from);
+        bitboard attacks = bishop_attack_set(from, occupied) & attack_mask;
+        if(set_contains(pinned, from)) attacks &= line_set(king, from);
+        count += set_cardinality(attacks);
+    }
+
+    while(queens)
+    {
+        square from = set_first(queens);
+        queens = set_erase(queens, from);
+        bitboard attacks = (rook_attack_set(from, occupied) | bishop_attack_set(from, occupied)) & attack_mask;
+        if(set_contains(pinned, from)) attacks &= line_set(king, from);
+        count += set_cardinality(attacks);
+    }
+
+    if(!kings) return count;
+
+    // king moves
+    bool attack_map = b.has_attack_maps() && !checkers;
+    bitboard attacked = attack_map ? b.attack_set(opponent(s)) : empty_set;
+
+    if(kingside_castle[s] && !checkers)
+    {
+        constexpr bitboard between = square_set(castle_f) | square_set(castle_g);
+        bool safe = attack_map ? !(between & attacked) : !b.attackers_to<opponent(s)>(castle_f, occupied) && !b.attackers_to<opponent(s)>(castle_g, occupied);
+        count += !(between & occupied) && safe;
+    }
+    if(queenside_castle[s] && !checkers)
+    {
+        constexpr bitboard between = square_set(castle_b) | square_set(castle_c) | square_set(castle_d);
+        constexpr bitboard path = square_set(castle_c) | square_set(castle_d);
+        bool safe = attack_map ? !(path & attacked) : !b.attackers_to<opponent(s)>(castle_d, occupied) && !b.attackers_to<opponent(s)>(castle_c, occupied);
+        count += !(between & occupied) && safe;
+    }
+
+    bitboard king_tos = king_attack_set(king) & ~b.side_set(s);
+    bitboard king_occupied = occupied ^ kings;
 
-    moves.resize(n);
+    if(attack_map)
+    {
+        return count + set_cardinality(king_tos & ~attacked);
+    }
 
-    return moves;
+    while(king_tos)
+    {
+        square to = set_first(king_tos);
+        king_tos = set_erase(king_tos, to);
+        count += !b.attackers_to<opponent(s)>(to, king_occupied);
+    }
+
+    return count;
+}
+
+bool position::is_legal(const move& m) const
+{
+    CHESS_PROBE(is_legal);
+
+    bool legal = turn == side_white ? is_legal<side_white>(m) : is_legal<side_black>(m);
+    CHESS_PROBE_VALUE(is_legal, !legal);
+    return legal;
+}
+
+template<side s>
+bool position::is_legal(const move& m) const
+{
+    bitboard kings = b.piece_set(piece_king, s);
+
+    if(!kings)
+    {
+        return true;
+    }
+
+    unsigned flags = m.flags & move_flag_unknown ? move_flags(m) : m.flags;
+    square king = set_first(kings);
+    bitboard occupied = b.occupied_set();
+
+    // the king can not castle out of, through or into check
+    if(flags & move_flag_castle)
+    {
+        square through = cat_coords(file_of(m.to) == file_g ? file_f : file_d, rank_of(m.from));
+
+        return !b.attackers_to<opponent(s)>(king, occupied)
+            && !b.attackers_to<opponent(s)>(through, occupied)
+            && !b.attackers_to<opponent(s)>(m.to, occupied);
+    }
+
+    // occupancy after the move
+    bitboard from_bb = square_set(m.from);
+    bitboard to_bb = square_set(m.to);
+    bitboard captured = flags & move_flag_en_passant ? square_set(cat_coords(file_of(m.to), rank_of(m.from))) : to_bb;
+    bitboard after = (occupied ^ from_bb ^ captured) | to_bb;
+
+    // a pinned piece leaving the line to the king uncovers its pinner, and a
+    // checker that is neither captured nor blocked still attacks the king
+    square target = m.from == king ? m.to : king;
+
+    return !(b.attackers_to<opponent(s)>(target, after) & ~captured);
+}
+
+bool position::gives_check(const move& m) const
+{
+    return turn == side_white ? gives_check<side_white>(m) : gives_check<side_black>(m);
+}
+
+template<side s>
+bool position::gives_check(const move& m) const
+{
+    bitboard kings = b.piece_set(piece_king, opponent(s));
+
+    if(!kings)
+    {
+        return false;
+    }
+
+    unsigned flags = m.flags & move_flag_unknown ? move_flags(m) : m.flags;
+    square king = set_first(kings);
+
+    piece moved = flags & move_flag_promotion ? m.promote : b.get(m.from).second;
+    square moved_to = m.to;
+
+    bitboard from_bb = square_set(m.from);
+    bitboard to_bb = square_set(m.to);
+    bitboard captured = flags & move_flag_en_passant ? square_set(cat_coords(file_of(m.to), rank_of(m.from))) : to_bb;
+    bitboard after = (b.occupied_set() ^ from_bb ^ captured) | to_bb;
+    bitboard vacated = from_bb;
+
+    // castling checks with the rook
+    if(flags & move_flag_castle)
+    {
+        bool kingside = file_of(m.to) == file_g;
+        square rook_from = cat_coords(kingside ? file_h : file_a, rank_of(m.from));
+        square rook_to = cat_coords(kingside ? file_f : file_d, rank_of(m.from));
+
+        after = (after ^ square_set(rook_from)) | square_set(rook_to);
+        vacated |= square_set(rook_from);
+        moved = piece_rook;
+        moved_to = rook_to;
+    }
+
+    // direct check by the moved piece
+    bitboard attacks = empty_set;
+
+    switch(moved)
+    {
+    case piece_pawn:    attacks = pawn_east_attack_set<s>(square_set(moved_to)) | pawn_west_attack_set<s>(square_set(moved_to)); break;
+    case piece_rook:    attacks = rook_attack_set(moved_to, after); break;
+    case piece_knight:  attacks = knight_attack_set(moved_to); break;
+    case piece_bishop:  attacks = bishop_attack_set(moved_to, after); break;
+    case piece_queen:   attacks = queen_attack_set(moved_to, after); break;
+    default:            break;
+    }
+
+    if(attacks & kings)
+    {
+        return true;
+    }
+
+    // discovered check by a slider behind a vacated square
+    bitboard rooks = (b.piece_set(piece_rook, s) | b.piece_set(piece_queen, s)) & ~vacated;
+    bitboard bishops = (b.piece_set(piece_bishop, s) | b.piece_set(piece_queen, s)) & ~vacated;
+
+    return (rook_attack_set(king, after) & rooks) || (bishop_attack_set(king, after) & bishops);
+}
+
+void position::set_attack_maps(bool enabled)
+{
+    b.set_attack_maps(enabled);
 }
 
 const board& position::get_board() const
@@ -589,6 +1086,11 @@ int position::get_halfmove_clock() const
     return halfmove_clock;
 }
 
+square position::get_en_passant() const
+{
+    return en_passant;
+}
+
 bool position::can_castle_kingside(side s) const
 {
     return kingside_castle[s];
@@ -627,17 +1129,18 @@ std::string position::to_string(bool coords) const
 
 bool position::is_check() const
 {
-    return b.attack_set(opponent(turn)) & b.piece_set(piece_king, turn);
+    bitboard kings = b.piece_set(piece_king, turn);
+    return kings && b.is_attacked(set_first(kings), opponent(turn));
 }
 
 bool position::is_checkmate() const
 {
-    return is_check() && moves().empty();
+    return is_check() && count_legal_moves() == 0;
 }
 
 bool position::is_stalemate() const
 {
-    return !is_check() && moves().empty();
+    return !is_check() && count_legal_moves() == 0;
 }
 
 bool position::is_threefold_repetition() const
@@ -710,17 +1213,17 @@ bool position::is_terminal() const
     return is_checkmate() || is_draw();
 }
 
-void position::piecewise_moves(square from, bitboard tos, piece promote, std::vector<move>& moves) const
+void position::piecewise_moves(square from, bitboard tos, bitboard captures, move_list& moves) const
 {
     while(tos)
     {
         square to = set_first(tos);
         tos = set_erase(tos, to);
-        moves.emplace_back(from, to, promote);
+        moves.emplace_back(from, to, piece_none, set_contains(captures, to) ? move_flag_capture : move_flag_quiet);
     }
 }
 
-void position::setwise_moves(bitboard froms, bitboard tos, piece promote, std::vector<move>& moves) const
+void position::setwise_moves(bitboard froms, bitboard tos, piece promote, unsigned flags, move_list& moves) const
 {
     while(froms && tos)
     {
@@ -728,7 +1231,7 @@ void position::setwise_moves(bitboard froms, bitboard tos, piece promote, std::v
         square to = set_first(tos);
         froms = set_erase(froms, from);
         tos = set_erase(tos, to);
-        moves.emplace_back(from, to, promote);
+        moves.emplace_back(from, to, promote, flags);
     }
 }
 
@@ -72,7 +72,7 @@ public:
     /// \note To get the initial position, the default position constructor can be used.
     static position from_fen(std::istream& in);
     
-    static position from_fen(const std::string& fen);
+    static position from_fen(std::string_view fen);
 
     /// Convert position to Forsyth-Edwards Notation (FEN).
     ///
@@ -81,9 +81,19 @@ public:
     /// \returns FEN encoding position.
 	std::string to_fen() const;
 
+    /// Move flags.
+    ///
+    /// Classifies a move in this position, returning the flags the move
+    /// generator would give it. Used to make moves with unknown flags.
+    ///
+    /// \param m The move.
+    /// \returns Move flags.
+    unsigned move_flags(const move& m) const;
+
     /// Make move.
     ///
-    /// Make move on given position by updating internal state.
+    /// Make move on given position by updating internal state. If the flags of
+    /// the move are unknown, they are computed first.
     ///
     /// \param m The move.
     /// \returns Undo data.
@@ -111,11 +121,31 @@ public:
 
     /// Legal moves.
     ///
-    /// Returns list of legal moves in position.
+    /// Returns list of legal moves in position. This allocates a vector, see
+    /// generate() for an allocation-free alternative.
     ///
     /// \returns List of legal moves.
     std::vector<move> moves() const;
 
+    /// Number of legal moves.
+    ///
+    /// Counts the legal moves in position without listing them, using the
+    /// cardinality of the destination sets of each piece (and of all pawns at
+    /// once). Equal to the size of the list from generate(), but cheaper.
+    ///
+    /// \returns Number of legal moves.
+    int count_legal_moves() const;
+
+    /// Enable or disable attack maps.
+    ///
+    /// Makes the board maintain attack maps incrementally. Move generation and
+    /// count_legal_moves() then use them for the safety of king moves and
+    /// castling paths when not in check. Check detection does not use them.
+    /// See board::set_attack_maps().
+    ///
+    /// \param enabled Whether to maintain attack maps.
+    void set_attack_maps(bool enabled);
+
     /// Position board.
     ///
     /// Returns the piece placement of the position.
@@ -152,6 +182,14 @@ public:
     /// \returns Halfmove clock.
     int get_halfmove_clock() const;
 
+    /// Get en passant square.
+    ///
+    /// Returns the square that a pawn can capture en passant on, which is
+    /// the square passed by a pawn that just made a double push.
+    ///
+    /// \returns En passant square, or none.
+    square get_en_passant() const;
+
     // Should only be used on positions managed by game class.
     int get_repetititons() const;
 
@@ -174,6 +212,29 @@ public:
     /// \returns Board string.
     std::string to_string(bool coords = true) const;
 
+    /// Legality of pseudo-legal move.
+    ///
+    /// Checks if a pseudo-legal move, such as one from generate_pseudo_legal(),
+    /// leaves the king of the moving side safe. Instead of making the move,
+    /// the attackers of the king are looked up with the occupancy after the
+    /// move, which catches both pinned pieces leaving their line and checks
+    /// that are not evaded. Moves that are not pseudo-legal give an
+    /// unspecified result.
+    ///
+    /// \param m The move.
+    /// \returns Whether the move is legal.
+    bool is_legal(const move& m) const;
+
+    /// Check by move.
+    ///
+    /// Checks if a legal move checks the opponent king, either directly by the
+    /// moved (or promoted) piece or by uncovering a slider behind it. Castling
+    /// can check with the rook.
+    ///
+    /// \param m The move.
+    /// \returns Whether the move gives check.
+    bool gives_check(const move& m) const;
+
     /// Check flag.
     ///
     /// Returns whether the side whose turn it is is checked.
@@ -207,8 +268,14 @@ public:
     bool is_terminal() const;
 
 private:
-    void piecewise_moves(square from, bitboard tos, piece promote, std::vector<move>& moves) const;
-    void setwise_moves(bitboard froms, bitboard tos, piece promote, std::vector<move>& moves) const;
+    void generate(move_list& moves, bitboard targets = universal_set, bitboard promote_targets = universal_set, bool legal = true) const;
+    template<side s, bool legal, bool evasions = false> void generate(move_list& moves, bitboard targets, bitboard promote_targets) const;
+    void generate_evasions(move_list& moves) const;
+    template<side s> int count_legal_moves() const;
+    template<side s> bool is_legal(const move& m) const;
+    template<side s> bool gives_check(const move& m) const;
+    void piecewise_moves(square from, bitboard tos, bitboard captures, move_list& moves) const;
+    void setwise_moves(bitboard froms, bitboard tos, piece promote, unsigned flags, move_list& moves) const;
 
     board b;
     side turn;
@@ -221,10 +288,81 @@ private:
     int repetitions;
 
     friend class game;
+    friend void generate(const position& p, move_list& moves);
+    friend void generate_captures(const position& p, move_list& moves);
+    friend void generate_quiets(const position& p, move_list& moves);
+    friend void generate_evasions(const position& p, move_list& moves);
+    friend void generate_targets(const position& p, move_list& moves, bitboard targets);
+    friend void generate_pseudo_legal(const position& p, move_list& moves);
 };
 
 
+/// Generate legal moves.
+///
+/// Appends the legal moves in a position to a move list. Unlike
+/// position::moves(), this does not allocate.
+///
+/// \param p The position.
+/// \param moves List to append moves to.
+void generate(const position& p, move_list& moves);
+
+
+/// Generate captures and promotions.
+///
+/// Appends the legal captures (including en passant) and promotions
+/// (including quiet ones) in a position to a move list.
+///
+/// \param p The position.
+/// \param moves List to append moves to.
+void generate_captures(const position& p, move_list& moves);
+
+
+/// Generate quiet moves.
+///
+/// Appends the legal moves that are neither captures nor promotions in a
+/// position to a move list. Together with generate_captures() this yields
+/// all legal moves.
+///
+/// \param p The position.
+/// \param moves List to append moves to.
+void generate_quiets(const position& p, move_list& moves);
+
+
+/// Generate check evasions.
+///
+/// Appends the legal moves in a position where the side to move is checked to
+/// a move list. If the side to move is not checked, nothing is appended.
+///
+/// \param p The position.
+/// \param moves List to append moves to.
+void generate_evasions(const position& p, move_list& moves);
+
+
+/// Generate moves to target squares.
+///
+/// Appends the legal moves that land on any of the target squares to a move
+/// list. An en passant capture counts as landing on the square of the
+/// captured pawn.
+///
+/// \param p The position.
+/// \param moves List to append moves to.
+/// \param targets Set of target squares.
+void generate_targets(const position& p, move_list& moves, bitboard targets);
+
+
+/// Generate pseudo-legal moves.
+///
+/// Appends the moves in a position that follow the movement rules of the
+/// pieces to a move list, without checking if they leave the own king in
+/// check. Castling only requires the castling right and empty squares between
+/// king and rook. Use position::is_legal() to test each move before making it.
+///
+/// \param p The position.
+/// \param moves List to append moves to.
+void generate_pseudo_legal(const position& p, move_list& moves);
+
+
 }
 
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+#include "probe.hpp"
+
+
+namespace chess
+{
+
+
+// counters of running threads, and totals of threads that have exited
+static std::mutex registry_mutex;
+static std::vector<probe_counters*> registry;
+static std::array<probe_stats, probes> retired{};
+
+
+static void accumulate(probe_stats& s, const probe_counters::counter& c)
+{
+    s.calls += c.calls.load(std::memory_order_relaxed);
+    s.cycles += c.cycles.load(std::memory_order_relaxed);
+    s.values += c.values.load(std::memory_order_relaxed);
+
+    for(int i = 0; i < probe_buckets; i++)
+    {
+        s.histogram[i] += c.histogram[i].load(std::memory_order_relaxed);
+    }
+}
+
+
+static void clear(probe_counters::counter& c)
+{
+    c.calls.store(0, std::memory_order_relaxed);
+    c.cycles.store(0, std::memory_order_relaxed);
+    c.values.store(0, std::memory_order_relaxed);
+
+    for(std::atomic<unsigned long long>& h: c.histogram)
+    {
+        h.store(0, std::memory_order_relaxed);
+    }
+}
+
+
+probe_counters::probe_counters()
+{
+    for(counter& c: counters)
+    {
+        clear(c);
+    }
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    registry.push_back(this);
+}
+
+
+probe_counters::~probe_counters()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    for(int p = 0; p < probes; p++)
+    {
+        accumulate(retired[p], counters[p]);
+    }
+
+    registry.erase(std::find(registry.begin(), registry.end(), this));
+}
+
+
+probe_counters& thread_probe_counters()
+{
+    static thread_local probe_counters counters;
+    return counters;
+}
+
+
+std::array<probe_stats, probes> probe_snapshot()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    std::array<probe_stats, probes> stats = retired;
+
+    for(const probe_counters* thread: registry)
+    {
+        for(int p = 0; p < probes; p++)
+        {
+            accumulate(stats[p], thread->counters[p]);
+        }
+    }
+
+    return stats;
+}
+
+
+void probe_reset()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    retired = {};
+
+    for(probe_counters* thread: registry)
+    {
+        for(probe_counters::counter& c: thread->counters)
+        {
+            clear(c);
+        }
+    }
+}
+
+
+// upper bound of the histogram bucket that contains a fraction of the calls
+static unsigned long long percentile(const probe_stats& s, double fraction)
+{
+    unsigned long long seen = 0;
+
+    for(int i = 0; i < probe_buckets; i++)
+    {
+        seen += s.histogram[i];
+        if(seen >= fraction * s.calls) return i < 64 ? 1ULL << i : ~0ULL;
+    }
+
+    return 0;
+}
+
+
+void probe_report(std::ostream& out)
+{
+    if(!probes_enabled())
+    {
+        out << "probes: disabled (compile with CHESS_PROBES)" << std::endl;
+        return;
+    }
+
+    std::array<probe_stats, probes> stats = probe_snapshot();
+
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+
+    out << std::left << std::setw(12) << "probe" << std::right << std::setw(14) << "calls" << std::setw(12) << "cycles"
+        << std::setw(12) << "p50 <" << std::setw(12) << "p99 <" << std::setw(12) << "value" << std::endl;
+
+    for(int p = 0; p < probes; p++)
+    {
+        const probe_stats& s = stats[p];
+        if(!s.calls) continue;
+
+        out << std::left << std::setw(12) << to_string(static_cast<probe>(p)) << std::right << std::fixed << std::setprecision(1)
+            << std::setw(14) << s.calls
+            << std::setw(12) << static_cast<double>(s.cycles) / s.calls
+            << std::setw(12) << percentile(s, 0.5)
+            << std::setw(12) << percentile(s, 0.99)
+            << std::setw(12) << static_cast<double>(s.values) / s.calls << std::endl;
+    }
+
+    const probe_stats& generated = stats[probe_generate];
+    const probe_stats& legal = stats[probe_is_legal];
+
+    if(generated.calls)
+    {
+        out << "moves generated: " << static_cast<double>(generated.values) / generated.calls << " per call" << std::endl;
+    }
+    if(legal.calls)
+    {
+        out << "illegal moves: " << 100.0 * legal.values / legal.calls << " %" << std::endl;
+    }
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+
+std::string to_string(probe p)
+{
+    switch(p)
+    {
+    case probe_moves:       return "moves";
+    case probe_generate:    return "generate";
+    case probe_make_move:   return "make_move";
+    case probe_undo_move:   return "undo_move";
+    case probe_copy_move:   return "copy_move";
+    case probe_attack_set:  return "attack_set";
+    case probe_set:         return "set";
+    case probe_is_legal:    return "is_legal";
+    default:                break;
+    }
+
+    return "none";
+}
+
+
+}
@@ -0,0 +1,200 @@
+#ifndef CHESS_PROBE_HPP
+#define CHESS_PROBE_HPP
+
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+
+namespace chess
+{
+
+
+/// Probes.
+///
+/// Points in hot paths that count calls, time them in cycles and record a
+/// value per call. Probes are compiled in when CHESS_PROBES is defined (for
+/// example with `make CPPFLAGS="-I. -DCHESS_PROBES"`), otherwise they expand to
+/// nothing and cost nothing.
+enum probe
+{
+    probe_moves,
+    probe_generate,
+    probe_make_move,
+    probe_undo_move,
+    probe_copy_move,
+    probe_attack_set,
+    probe_set,
+    probe_is_legal,
+    probes,
+};
+
+
+/// Number of cycle histogram buckets, bucket i counts calls of less than 2^i cycles.
+const int probe_buckets = 65;
+
+
+/// Probe statistics.
+///
+/// Totals of a probe over all threads. The meaning of the value depends on
+/// the probe: moves generated for probe_moves and probe_generate, illegal
+/// moves for probe_is_legal.
+struct probe_stats
+{
+    unsigned long long calls;
+    unsigned long long cycles;
+    unsigned long long values;
+    std::array<unsigned long long, probe_buckets> histogram;
+};
+
+
+/// Whether probes are compiled in.
+///
+/// \returns True if CHESS_PROBES is defined.
+constexpr bool probes_enabled()
+{
+#ifdef CHESS_PROBES
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+/// Probe statistics.
+///
+/// Sums the counters of all threads, including threads that have exited.
+/// Can be called while other threads are running, in which case the counts
+/// may be slightly behind.
+///
+/// \returns Statistics of every probe.
+std::array<probe_stats, probes> probe_snapshot();
+
+
+/// Reset probe statistics.
+///
+/// Zeroes the counters of all threads. Should not be called while probes run
+/// in other threads.
+void probe_reset();
+
+
+/// Probe report.
+///
+/// Writes calls, mean and approximate median and 99th percentile cycles and
+/// mean value per call of each probe that has been hit, as well as the
+/// average number of moves generated and the rate of illegal moves.
+///
+/// \param out The stream.
+void probe_report(std::ostream& out);
+
+
+/// Probe to string.
+///
+/// \param p The probe.
+/// \returns Name of the probe.
+std::string to_string(probe p);
+
+
+/// Probe counters of a thread.
+///
+/// Only the owning thread writes the counters, other threads read them for
+/// snapshots, so the counters are atomic but updated without read-modify-write.
+struct probe_counters
+{
+    struct counter
+    {
+        std::atomic<unsigned long long> calls;
+        std::atomic<unsigned long long> cycles;
+        std::atomic<unsigned long long> values;
+        std::array<std::atomic<unsigned long long>, probe_buckets> histogram;
+    };
+
+    probe_counters();
+    ~probe_counters();
+
+    static void add(std::atomic<unsigned long long>& c, unsigned long long n)
+    {
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::array<counter, probes> counters;
+};
+
+
+/// Counters of the calling thread.
+probe_counters& thread_probe_counters();
+
+
+/// Cycle counter.
+///
+/// The time stamp counter on x86, nanoseconds elsewhere.
+inline std::uint64_t probe_clock()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+
+/// Timed probe scope.
+///
+/// Counts a call and its cycles from construction to destruction.
+class probe_scope
+{
+public:
+    explicit probe_scope(probe p):
+    p{p},
+    begin{probe_clock()}
+    {}
+
+    ~probe_scope()
+    {
+        std::uint64_t cycles = probe_clock() - begin;
+        probe_counters::counter& c = thread_probe_counters().counters[p];
+
+        probe_counters::add(c.calls, 1);
+        probe_counters::add(c.cycles, cycles);
+        probe_counters::add(c.histogram[std::bit_width(cycles)], 1);
+    }
+
+    probe_scope(const probe_scope&) = delete;
+    probe_scope& operator=(const probe_scope&) = delete;
+
+private:
+    probe p;
+    std::uint64_t begin;
+};
+
+
+/// Add to the value of a probe.
+inline void probe_value(probe p, unsigned long long value)
+{
+    probe_counters::add(thread_probe_counters().counters[p].values, value);
+}
+
+
+}
+
+
+#ifdef CHESS_PROBES
+#define CHESS_PROBE(name) ::chess::probe_scope chess_probe_##name(::chess::probe_##name)
+#define CHESS_PROBE_VALUE(name, value) ::chess::probe_value(::chess::probe_##name, (value))
+#else
+#define CHESS_PROBE(name) ((void)0)
+#define CHESS_PROBE_VALUE(name, value) ((void)sizeof(value))
+#endif
+
+
+#endif
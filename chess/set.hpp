@@ -23,10 +23,10 @@ namespace chess
 using bitboard = std::uint64_t;
 
 /// Empty set.
-const bitboard empty_set = 0ULL;
+constexpr bitboard empty_set = 0ULL;
 
 /// Universal set.
-const bitboard universal_set = ~0ULL;
+constexpr bitboard universal_set = ~0ULL;
 
 /// Square set.
 ///
@@ -61,6 +61,32 @@ constexpr bitboard rank_set(rank r)
     return 0xFFULL << (r*8);
 }
 
+/// Diagonal set.
+///
+/// The set with all squares on the diagonal (in the A1-H8 direction) through
+/// the given square in it.
+///
+/// \param sq The square.
+/// \returns Bitboard with all bits of the diagonal set.
+constexpr bitboard diagonal_set(square sq)
+{
+    int d = static_cast<int>(file_of(sq)) - static_cast<int>(rank_of(sq));
+    return d >= 0 ? 0x8040201008040201ULL >> (d*8) : 0x8040201008040201ULL << (-d*8);
+}
+
+/// Anti-diagonal set.
+///
+/// The set with all squares on the anti-diagonal (in the H1-A8 direction)
+/// through the given square in it.
+///
+/// \param sq The square.
+/// \returns Bitboard with all bits of the anti-diagonal set.
+constexpr bitboard antidiagonal_set(square sq)
+{
+    int d = static_cast<int>(file_of(sq)) + static_cast<int>(rank_of(sq)) - 7;
+    return d >= 0 ? 0x0102040810204080ULL << (d*8) : 0x0102040810204080ULL >> (-d*8);
+}
+
 /// Check if set contains square.
 ///
 /// Returns whether the bit corresponding to the square is set to 1.
@@ -179,6 +205,40 @@ inline bitboard set_complement(bitboard bb)
 std::vector<square> set_elements(bitboard bb);
 
 
+/// Wrap-around trim of directional shift.
+///
+/// Returns the files that squares shifted in the given direction would wrap
+/// around to, and that should therefore be removed from a shifted set.
+///
+/// \param d The direction.
+/// \returns The files to trim.
+constexpr bitboard shift_trim(direction d)
+{
+    switch(d)
+    {
+    case direction_e:
+    case direction_ne:
+    case direction_se:
+    case direction_nne:
+    case direction_sse:
+        return file_set(file_a);
+    case direction_w:
+    case direction_nw:
+    case direction_sw:
+    case direction_nnw:
+    case direction_ssw:
+        return file_set(file_h);
+    case direction_ene:
+    case direction_ese:
+        return file_set(file_a) | file_set(file_b);
+    case direction_wnw:
+    case direction_wsw:
+        return file_set(file_g) | file_set(file_h);
+    default:
+        return empty_set;
+    }
+}
+
 /// Directional shift of set.
 ///
 /// Shifts bitboard in given direction. For example, the bitboard
@@ -188,7 +248,39 @@ std::vector<square> set_elements(bitboard bb);
 /// \param bb The set.
 /// \param d The direction.
 /// \returns The set shifted in the direction.
-bitboard set_shift(bitboard bb, direction d);
+constexpr bitboard set_shift(bitboard bb, direction d)
+{
+    if(d > 0)
+    {
+        bb <<= d;
+    }
+    else
+    {
+        bb >>= -d;
+    }
+
+    return bb & ~shift_trim(d);
+}
+
+/// Directional shift of set, with direction known at compile time.
+///
+/// Same as set_shift(bb, d), but the shift amount and trim are constants.
+///
+/// \tparam d The direction.
+/// \param bb The set.
+/// \returns The set shifted in the direction.
+template<direction d>
+constexpr bitboard set_shift(bitboard bb)
+{
+    if constexpr(d > 0)
+    {
+        return (bb << d) & ~shift_trim(d);
+    }
+    else
+    {
+        return (bb >> -d) & ~shift_trim(d);
+    }
+}
 
 
 /// Ray cast of a set.
@@ -200,7 +292,46 @@ bitboard set_shift(bitboard bb, direction d);
 /// \param d The direction to cast ray in.
 /// \param occupied Occupancy set for collisions.
 /// \returns Set with rays.
-bitboard set_ray(bitboard bb, direction d, bitboard occupied);
+constexpr bitboard set_ray(bitboard bb, direction d, bitboard occupied)
+{
+    bitboard shift = bb;
+    bitboard ray = 0;
+    while(shift != 0 && !(shift & occupied))
+    {
+        shift = set_shift(shift, d);
+        ray |= shift;
+    }
+    return ray;
+}
+
+/// Ray cast of a set, with direction known at compile time.
+///
+/// Same as set_ray(bb, d, occupied), but rays are cast from every set bit
+/// independently with a Kogge-Stone fill, in a fixed number of steps.
+///
+/// \tparam d The direction.
+/// \param bb The set.
+/// \param occupied Occupancy set for collisions.
+/// \returns Set with rays.
+template<direction d>
+constexpr bitboard set_ray(bitboard bb, bitboard occupied)
+{
+    constexpr auto shift = [](bitboard x, int n)
+    {
+        return d > 0 ? x << (n*d) : x >> (-n*d);
+    };
+
+    // squares that rays can pass through without wrapping around
+    bitboard empty = ~occupied & ~shift_trim(d);
+
+    bb |= empty & shift(bb, 1);
+    empty &= shift(empty, 1);
+    bb |= empty & shift(bb, 2);
+    empty &= shift(empty, 2);
+    bb |= empty & shift(bb, 4);
+
+    return set_shift<d>(bb);
+}
 
 
 }
@@ -2,6 +2,7 @@
 #define CHESS_SQUARE_HPP
 
 
+#include <cstdint>
 #include <string>
 #include <stdexcept>
 
@@ -31,7 +32,9 @@ enum rank
 const int ranks = 8;
 
 /// Squares on a chess board.
-enum square
+///
+/// Stored in a byte, so that moves and mailboxes stay small.
+enum square : std::int8_t
 {
     square_a1, square_b1, square_c1, square_d1, square_e1, square_f1, square_g1, square_h1,
     square_a2, square_b2, square_c2, square_d2, square_e2, square_f2, square_g2, square_h2, 
@@ -15,11 +15,56 @@ namespace chess
 {
 
 
-std::size_t zobrist_piece_key(square sq, side s, piece p);
-std::size_t zobrist_kingside_castle_key(side s);
-std::size_t zobrist_queenside_castle_key(side s);
-std::size_t zobrist_en_passant_key(file f);
-std::size_t zobrist_side_key();
+/// Zobrist keys.
+///
+/// Drawn by zobrist_init(), and read through the const accessors everywhere
+/// else.
+class zobrist_key_table
+{
+public:
+    std::size_t piece_key(square sq, side s, piece p) const { return piece_keys[sq][s][p]; }
+    std::size_t kingside_castle_key(side s) const { return kingside_castle_keys[s]; }
+    std::size_t queenside_castle_key(side s) const { return queenside_castle_keys[s]; }
+    std::size_t en_passant_key(file f) const { return en_passant_keys[f]; }
+    std::size_t side_key() const { return side_to_move_key; }
+
+private:
+    friend void zobrist_init(random& rng);
+
+    std::array<std::array<std::array<std::size_t, pieces>, sides>, squares> piece_keys{};
+    std::array<std::size_t, sides> kingside_castle_keys{};
+    std::array<std::size_t, sides> queenside_castle_keys{};
+    std::array<std::size_t, files> en_passant_keys{};
+    std::size_t side_to_move_key = 0;
+};
+
+extern zobrist_key_table zobrist_keys;
+
+
+inline std::size_t zobrist_piece_key(square sq, side s, piece p)
+{
+    return zobrist_keys.piece_key(sq, s, p);
+}
+
+inline std::size_t zobrist_kingside_castle_key(side s)
+{
+    return zobrist_keys.kingside_castle_key(s);
+}
+
+inline std::size_t zobrist_queenside_castle_key(side s)
+{
+    return zobrist_keys.queenside_castle_key(s);
+}
+
+inline std::size_t zobrist_en_passant_key(file f)
+{
+    return zobrist_keys.en_passant_key(f);
+}
+
+inline std::size_t zobrist_side_key()
+{
+    return zobrist_keys.side_key();
+}
 
 
 void zobrist_init(random& rng);
@@ -0,0 +1,130 @@
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include <chess/chess.hpp>
+#include <bench/bench.hpp>
+
+
+using namespace chess;
+
+
+// every allocation in the program passes through these
+static std::atomic<unsigned long long> allocation_count{0};
+
+void* operator new(std::size_t size)
+{
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	if(void* p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+
+// Allocations of one call of a function, after a first call that may set up
+// thread local or cached state.
+template<typename F>
+unsigned long long allocations(F&& f)
+{
+	f();
+	unsigned long long before = allocation_count.load(std::memory_order_relaxed);
+	f();
+	return allocation_count.load(std::memory_order_relaxed) - before;
+}
+
+
+// hot paths must not allocate at all
+void test(unsigned long long count, std::string_view name)
+{
+	std::cerr << "alloc test '" << name << "': ";
+	if(count == 0)
+	{
+		std::cerr << "success" << std::endl;
+	}
+	else
+	{
+		std::cerr << "failure (" << count << " allocations)" << std::endl << std::endl;
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+// other calls are only reported
+void report(unsigned long long count, std::string_view name)
+{
+	std::cout << name << ": " << count << " allocations" << std::endl;
+}
+
+
+int main(int argc, char* argv[])
+{
+	chess::init();
+
+	position p = position::from_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+	move_list moves;
+	generate(p, moves);
+	move m = moves[0];
+	const board& b = p.get_board();
+
+	position mapped = p;
+	mapped.set_attack_maps(true);
+
+	// generation
+	test(allocations([&]{ move_list l; generate(p, l); }), "generate");
+	test(allocations([&]{ move_list l; generate_captures(p, l); generate_quiets(p, l); }), "generate_{captures,quiets}");
+	test(allocations([&]{ move_list l; generate_pseudo_legal(p, l); for(const move& pm: l) keep(p.is_legal(pm)); }), "generate_pseudo_legal");
+	test(allocations([&]{ move_picker mp(p); while(!mp.next().is_null()); }), "move_picker");
+	test(allocations([&]{ keep(p.count_legal_moves()); }), "position::count_legal_moves");
+
+	// make and undo
+	test(allocations([&]{ for(const move& pm: moves) { undo u = p.make_move(pm); p.undo_move(pm, u); } }), "position::{make,undo}_move");
+	test(allocations([&]{ for(const move& pm: moves) { undo u = mapped.make_move(pm); mapped.undo_move(pm, u); } }), "position::{make,undo}_move (attack maps)");
+	test(allocations([&]{ keep(p.copy_move(m)); }), "position::copy_move");
+	test(allocations([&]{ keep(mapped.copy_move(m)); }), "position::copy_move (attack maps)");
+
+	// hashing
+	test(allocations([&]{ keep(p.hash()); keep(p.copy_move(m).hash()); }), "position::hash");
+
+	// attack queries
+	test(allocations([&]{ keep(rook_attack_set(square_d4, b.occupied_set())); keep(bishop_attack_set(square_d4, b.occupied_set())); }), "slider attack sets");
+	test(allocations([&]{ keep(b.attack_set(side_white)); keep(b.fill_attack_set(side_black)); keep(mapped.get_board().attack_set(side_white)); }), "board::attack_set");
+	test(allocations([&]{ keep(b.attackers_to(square_e4, b.occupied_set())); keep(b.is_attacked(square_e1, side_black)); }), "board::attackers_to");
+	test(allocations([&]{ keep(p.is_check()); keep(p.is_checkmate()); keep(p.is_stalemate()); keep(p.gives_check(m)); }), "position::is_check");
+
+	// calls that allocate by design, for reference
+	report(allocations([&]{ p.moves(); }), "position::moves");
+	report(allocations([&]{ set_elements(b.occupied_set()); }), "set_elements");
+	report(allocations([&]{ position::from_fen(p.to_fen()); }), "position::{from,to}_fen");
+	report(allocations([&]{ m.to_lan(); }), "move::to_lan");
+	game g;
+	std::vector<move> game_moves = g.get_moves();
+	report(allocations([&]{ for(const move& gm: game_moves) { g.push(gm); g.pop(); } }), "game::{push,pop}");
+
+	exit(EXIT_SUCCESS);
+}
@@ -21,6 +21,210 @@ void test(bool expr, std::string_view name)
 }
 
 
+// packed moves keep the flags of generated moves
+bool test_packed_move_flags()
+{
+	for(const char* fen: {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1", "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1"})
+	{
+		for(const move& m: position::from_fen(fen).moves())
+		{
+			if(packed_move(m).unpack().flags != m.flags) return false;
+		}
+	}
+
+	move knight(square_g1, square_f3);
+	move unpacked = packed_move(knight).unpack();
+	if(unpacked != knight || unpacked.flags != knight.flags) return false;
+
+	return packed_move(move::from_lan("e2e4")).unpack().flags == move_flag_unknown;
+}
+
+
+// the hash move is returned first, and only once
+bool test_move_picker(std::string_view fen, move hash_move, std::size_t count)
+{
+	position p = position::from_fen(fen);
+	move_picker mp(p, hash_move);
+	std::size_t n = 0;
+
+	if(mp.next() != hash_move) return false;
+
+	for(move m = mp.next(); !m.is_null(); m = mp.next())
+	{
+		if(m == hash_move) return false;
+		n++;
+	}
+
+	return n + 1 == count;
+}
+
+
+// every backend gives the same attacks as the magic backend
+bool test_set_slider_backend()
+{
+	slider_backend prev = get_slider_backend();
+	bool same = true;
+
+	for(slider_backend b: {slider_pext, slider_compact})
+	{
+		if(!set_slider_backend(b)) continue;
+
+		for(int i = square_a1; i <= square_h8; i++)
+		{
+			square sq = static_cast<square>(i);
+
+			for(bitboard occupied: {bitboard(0), bitboard(0x0123456789abcdefULL), bitboard(0x00ff00000000ff00ULL)})
+			{
+				set_slider_backend(b);
+				bitboard rook = rook_attack_set(sq, occupied);
+				bitboard bishop = bishop_attack_set(sq, occupied);
+
+				set_slider_backend(slider_magic);
+				same = same && rook == rook_attack_set(sq, occupied) && bishop == bishop_attack_set(sq, occupied);
+			}
+		}
+	}
+
+	set_slider_backend(prev);
+	return same;
+}
+
+
+// attack maps kept through make_move match the attacks of a fresh board
+bool test_set_attack_maps()
+{
+	position p = position::from_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+	p.set_attack_maps(true);
+
+	for(const char* lan: {"e1g1", "b4c3", "d2c3", "h3g2"})
+	{
+		p.make_move(move::from_lan(lan));
+	}
+
+	board b = position::from_fen(p.to_fen()).get_board();
+	return p.get_board().attack_set(side_white) == b.attack_set(side_white) && p.get_board().attack_set(side_black) == b.attack_set(side_black);
+}
+
+
+// batch results match the scalar results for some positions and their successors
+bool test_position_batch()
+{
+	position_batch batch;
+	std::vector<position> ps;
+
+	for(const char* fen: {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1", "r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1", "2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"})
+	{
+		position p = position::from_fen(fen);
+		ps.push_back(p);
+
+		for(const move& m: p.moves())
+		{
+			ps.push_back(p.copy_move(m));
+		}
+	}
+
+	for(const position& p: ps)
+	{
+		batch.push_back(p);
+	}
+
+	std::vector<int> counts = batch.legal_move_counts();
+	std::vector<std::uint8_t> checks = batch.checks();
+	std::vector<bitboard> attacks = batch.attack_sets();
+
+	for(std::size_t i = 0; i < ps.size(); i++)
+	{
+		if(counts[i] != static_cast<int>(ps[i].moves().size())) return false;
+		if(checks[i] != ps[i].is_check()) return false;
+		if(attacks[i] != ps[i].get_board().attack_set(ps[i].get_turn())) return false;
+	}
+
+	return batch.size() == ps.size();
+}
+
+
+// moves with and without generator flags make and undo the same way
+bool test_make_undo_move()
+{
+	position p = position::from_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+	std::string fen = p.to_fen();
+
+	for(const move& m: p.moves())
+	{
+		undo u = p.make_move(m);
+		p.undo_move(m, u);
+
+		undo v = p.make_move(move(m.from, m.to, m.promote));
+		p.undo_move(m, v);
+
+		if(u.flags != v.flags || p.to_fen() != fen) return false;
+	}
+
+	return true;
+}
+
+
+// setwise attacks match the attacks computed piece by piece
+bool test_fill_attack_set()
+{
+	for(const char* fen: {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10"})
+	{
+		board b = position::from_fen(fen).get_board();
+
+		if(b.fill_attack_set(side_white) != b.attack_set(side_white)) return false;
+		if(b.fill_attack_set(side_black) != b.attack_set(side_black)) return false;
+	}
+
+	return true;
+}
+
+
+// the pseudo-legal moves that is_legal() accepts are the legal moves
+bool test_is_legal()
+{
+	position p = position::from_fen("r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1");
+	move_list pseudo, legal;
+	generate_pseudo_legal(p, pseudo);
+	generate(p, legal);
+
+	std::size_t n = 0;
+
+	for(const move& m: pseudo)
+	{
+		n += p.is_legal(m);
+	}
+
+	return n == legal.size() && n < pseudo.size();
+}
+
+
+// gives_check() agrees with making the move
+bool test_gives_check()
+{
+	position p = position::from_fen("r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10");
+
+	for(const move& m: p.moves())
+	{
+		if(p.gives_check(m) != p.copy_move(m).is_check()) return false;
+	}
+
+	return p.gives_check(move::from_lan("c4f7"));
+}
+
+
+// counted moves match generated moves in positions with pins, checks and special moves
+bool test_count_legal_moves()
+{
+	for(const char* fen: {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1", "r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1", "2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1"})
+	{
+		position p = position::from_fen(fen);
+		if(p.count_legal_moves() != static_cast<int>(p.moves().size())) return false;
+	}
+
+	return true;
+}
+
+
 int main(int argc, char* argv[])
 {
 	chess::init();
@@ -54,11 +258,41 @@ int main(int argc, char* argv[])
 	test(set_elements(square_set(square_e4)).front() == square_e4, "set_elements");
 	test(set_shift(file_set(file_a), direction_e) == file_set(file_b), "set_shift");
 	test(set_ray(square_set(square_a1), direction_e, empty_set) == set_erase(rank_set(rank_1), square_a1), "set_ray");
+	test([]{ bitboard a = queen_attack_set(square_d4, 0x0123456789abcdefULL); chess::init(1); bool same = a == queen_attack_set(square_d4, 0x0123456789abcdefULL); chess::init(); return same; }(), "attack_init");
+	test(test_set_slider_backend(), "set_slider_backend");
+	test(set_ray<direction_n>(square_set(square_a1) | square_set(square_b2), square_set(square_a4)) == (set_ray(square_set(square_a1), direction_n, square_set(square_a4)) | set_ray(square_set(square_b2), direction_n, empty_set)), "set_ray<d>");
+	test([]{ constexpr bitboard b = knight_attack_set(square_a1); return b; }() == (square_set(square_b3) | square_set(square_c2)), "constexpr knight_attack_set");
+	test([]{ constexpr bitboard b = king_attack_set(square_h8); return b; }() == (square_set(square_g8) | square_set(square_g7) | square_set(square_h7)), "constexpr king_attack_set");
+	test([]{ constexpr bitboard b = set_ray(square_set(square_a1), direction_ne, square_set(square_c3)); return b; }() == (square_set(square_b2) | square_set(square_c3)), "constexpr set_ray");
 	test(move::from_lan("h7h8q").to_lan() == "h7h8q", "move::{from,to}_lan");
+	test(packed_move::from_lan("h7h8n").to_lan() == "h7h8n" && sizeof(packed_move) == 2, "packed_move::{from,to}_lan");
+	test(packed_move(move(square_e2, square_e4, piece_none)).unpack() == move(square_e2, square_e4, piece_none), "packed_move::unpack");
+	test(test_packed_move_flags(), "packed_move::flags");
+	test(sizeof(move) == 4, "sizeof(move)");
 	test(position::from_fen(position::fen_start).to_fen() == position::fen_start, "position::{from,to}_fen");
+	test(position().move_flags(move::from_lan("e2e4")) == move_flag_double_push, "position::move_flags");
+	test(test_make_undo_move(), "position::{make,undo}_move");
+	test(test_set_attack_maps(), "board::set_attack_maps");
+	test(test_fill_attack_set(), "board::fill_attack_set");
+	test(board().attackers_to(square_f3, board().occupied_set()) == (square_set(square_e2) | square_set(square_g2) | square_set(square_g1)) && board().attackers_to(square_d4, empty_set) == (square_set(square_d1) | square_set(square_d8)), "board::attackers_to");
+	test(position().get_board().is_attacked(square_f3, side_white) && !position().get_board().is_attacked(square_e4, side_white), "board::is_attacked");
 	test(position::from_fen("k6R/8/8/8/8/8/8/7K b - - 0 1").is_check(), "position::is_check");
 	test(position::from_fen("k6R/7R/8/8/8/8/8/7K b - - 0 1").is_checkmate(), "position::is_checkmate");
 	test(position::from_fen("k7/7R/8/8/8/8/8/1R5K b - - 0 1").is_stalemate(), "position::is_stalemate");
+	test([]{ move_list l; generate(position(), l); return l.size() == 20; }(), "generate");
+	test([]{ move_list l; generate_captures(position::from_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"), l); return l.size() == 8; }(), "generate_captures");
+	test([]{ move_list l; generate_quiets(position::from_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"), l); return l.size() == 40; }(), "generate_quiets");
+	test([]{ move_list l; generate_evasions(position::from_fen("k6R/8/8/8/8/8/8/7K b - - 0 1"), l); return l.size() == 2; }(), "generate_evasions");
+	test([]{ move_list l; generate_evasions(position(), l); generate_evasions(position::from_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"), l); return l.empty(); }(), "generate_evasions (not checked)");
+	test([]{ move_list l; generate_targets(position(), l, rank_set(rank_4)); return l.size() == 8; }(), "generate_targets");
+	test([]{ move_list l; generate_pseudo_legal(position::from_fen("k6R/8/8/8/8/8/8/7K b - - 0 1"), l); return l.size() == 3; }(), "generate_pseudo_legal");
+	test(test_is_legal(), "position::is_legal");
+	test(test_gives_check(), "position::gives_check");
+	test(test_count_legal_moves(), "position::count_legal_moves");
+	test([]{ probe_reset(); position p; p.copy_move(p.moves().front()); auto stats = probe_snapshot(); return probes_enabled() ? stats[probe_make_move].calls == 1 && stats[probe_moves].values == 20 : stats[probe_make_move].calls == 0; }(), "probe_snapshot");
+	test(test_move_picker("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", move(square_e2, square_a6, piece_none), 48), "move_picker");
+	test(test_move_picker("rnbqkbnr/ppp1p1pp/8/3pPp2/4P3/8/PPPP2PP/RNBQKBNR w KQkq f6 0 3", move(square_e5, square_f6, piece_none), position::from_fen("rnbqkbnr/ppp1p1pp/8/3pPp2/4P3/8/PPPP2PP/RNBQKBNR w KQkq f6 0 3").moves().size()), "move_picker (en passant)");
+	test(test_position_batch(), "position_batch");
 	test(game().get_repetitions() == 1, "game::get_repetitions()");
 
 	exit(EXIT_SUCCESS);
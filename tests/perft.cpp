@@ -1,30 +1,196 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <deque>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <chrono>
+#include <vector>
 
 #include <chess/chess.hpp>
+#include <bench/counters.hpp>
 
 using namespace chess;
 
-struct entry
-{
-    std::size_t hash;
-    unsigned long long nodes;
-    int depth;
-};
-
 struct result
 {
     std::string fen;
     std::vector<unsigned long long> nodes;
 };
 
-static std::unordered_map<std::size_t, entry> table;
-static const size_t table_key_size = 24;
-static const size_t table_hash_mask = (1ULL << table_key_size) - 1;
-unsigned int        table_hits{0};
+// Shared perft hash table.
+//
+// A power of two number of buckets, each a cache line of four entries. Entries
+// are written without locks: the key is stored xor the data, so an entry torn
+// by concurrent writes fails verification and is treated as a miss. Within a
+// bucket, the entry of the same position or else the shallowest entry is
+// replaced, so results of deep (expensive) subtrees are kept.
+class perft_table
+{
+public:
+    perft_table():
+    size{0}
+    {}
+
+    void resize(std::size_t megabytes)
+    {
+        size = 0;
+        buckets.reset();
+
+        std::size_t count = megabytes * 1024 * 1024 / sizeof(bucket);
+
+        if(count)
+        {
+            size = std::bit_floor(count);
+            buckets = std::make_unique<bucket[]>(size);
+        }
+    }
+
+    void clear()
+    {
+        for(std::size_t i = 0; i < size; i++)
+        {
+            for(slot& s: buckets[i].slots)
+            {
+                s.key.store(0, std::memory_order_relaxed);
+                s.data.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool probe(std::size_t hash, int depth, unsigned long long& nodes)
+    {
+        if(!size) return false;
+
+        stats.probes++;
+
+        for(slot& s: buckets[hash & (size - 1)].slots)
+        {
+            std::uint64_t data = s.data.load(std::memory_order_relaxed);
+            std::uint64_t key = s.key.load(std::memory_order_relaxed);
+
+            if((key ^ data) == hash && static_cast<int>(data & depth_mask) == depth)
+            {
+                stats.hits++;
+                nodes = data >> depth_bits;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void store(std::size_t hash, int depth, unsigned long long nodes)
+    {
+        if(!size) return;
+
+        slot* replace = nullptr;
+        int replace_depth = depth_mask + 1;
+
+        for(slot& s: buckets[hash & (size - 1)].slots)
+        {
+            std::uint64_t data = s.data.load(std::memory_order_relaxed);
+            std::uint64_t key = s.key.load(std::memory_order_relaxed);
+            int slot_depth = data & depth_mask;
+
+            // the same position keeps the result of the greater depth
+            if((key ^ data) == hash)
+            {
+                if(slot_depth > depth) return;
+                replace = &s;
+                break;
+            }
+
+            if(slot_depth < replace_depth)
+            {
+                replace = &s;
+                replace_depth = slot_depth;
+            }
+        }
+
+        std::uint64_t data = (nodes << depth_bits) | (depth & depth_mask);
+        replace->key.store(hash ^ data, std::memory_order_relaxed);
+        replace->data.store(data, std::memory_order_relaxed);
+    }
+
+    // add the statistics of the calling thread to the totals
+    void flush()
+    {
+        probes += stats.probes;
+        hits += stats.hits;
+        stats = {};
+    }
+
+    double hit_rate() const
+    {
+        return probes ? static_cast<double>(hits) / probes : 0.0;
+    }
+
+    double occupancy() const
+    {
+        std::size_t used = 0;
+
+        for(std::size_t i = 0; i < size; i++)
+        {
+            for(const slot& s: buckets[i].slots)
+            {
+                used += s.data.load(std::memory_order_relaxed) != 0;
+            }
+        }
+
+        return size ? static_cast<double>(used) / (size * ways) : 0.0;
+    }
+
+    std::size_t megabytes() const
+    {
+        return size * sizeof(bucket) / (1024 * 1024);
+    }
+
+private:
+    // data is the node count above the depth
+    static constexpr int depth_bits = 6;
+    static constexpr std::uint64_t depth_mask = (1ULL << depth_bits) - 1;
+    static constexpr int ways = 4;
+
+    struct slot
+    {
+        std::atomic<std::uint64_t> key;
+        std::atomic<std::uint64_t> data;
+    };
+
+    struct alignas(64) bucket
+    {
+        slot slots[ways];
+    };
+
+    struct counters
+    {
+        unsigned long long probes = 0;
+        unsigned long long hits = 0;
+    };
+
+    std::unique_ptr<bucket[]> buckets;
+    std::size_t size;
+    std::atomic<unsigned long long> probes{0};
+    std::atomic<unsigned long long> hits{0};
+
+    // counted per thread, to not share a cache line between threads on every probe
+    static thread_local counters stats;
+};
+
+thread_local perft_table::counters perft_table::stats;
+
+static perft_table table;
 
 static std::unordered_map<std::string, result> results
 {
@@ -32,7 +198,7 @@ static std::unordered_map<std::string, result> results
     {"p2", {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", {1, 48, 2039, 97862, 4085603, 193690690, 8031647685}}},
     {"p3", {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", {1, 14, 191, 2812, 43238, 674624, 11030083, 178633661, 3009794393}}},
     {"p4", {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", {1, 6, 264, 9467, 422333, 15833292, 706045033}}},
-    {"p5", {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", {1, 44, 14686, 62379, 2103487, 89941194}}},
+    {"p5", {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", {1, 44, 1486, 62379, 2103487, 89941194}}},
     {"p6", {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", {1, 46, 2079, 89890, 3894594, 164075551, 6923051137, 287188994746, 11923589843526, 490154852788714}}},
 };
 
@@ -41,18 +207,21 @@ unsigned long long perft(int depth, position& p, bool divide = false)
 {
     if(depth == 0) return 1;
 
+    // leaves are counted without making their moves
+    if(depth == 1 && !divide) return p.count_legal_moves();
+
     std::size_t hash = p.hash();
-    std::size_t key = hash & table_hash_mask;
-    
-    if(table.find(key) != table.end() && table.at(key).hash == hash && table.at(key).depth == depth)
+    unsigned long long nodes = 0;
+
+    if(!divide && table.probe(hash, depth, nodes))
     {
-        table_hits++;
-        return table.at(key).nodes;
+        return nodes;
     }
 
-    unsigned long long nodes = 0;
+    move_list moves;
+    generate(p, moves);
 
-    for(move& move: p.moves())
+    for(move& move: moves)
     {
         undo undo = p.make_move(move);
         unsigned long long move_nodes = perft(depth - 1, p);
@@ -66,19 +235,204 @@ unsigned long long perft(int depth, position& p, bool divide = false)
         }
     }
 
-    table.emplace(key, entry{hash, nodes, depth});
+    table.store(hash, depth, nodes);
 
     return nodes;
 }
 
-int test(int depth = 5)
+// Parallel perft.
+//
+// The root and the plies below it are split into tasks, which are run by a
+// pool of threads. Each thread has a deque of tasks: it takes new tasks from
+// the back of its own deque and, when that is empty, steals old (and large)
+// tasks from the front of the others. Nodes are summed per root move, so
+// divide output is the same as for a single thread.
+class perft_pool
+{
+public:
+    perft_pool(int threads, int split_plies = 2):
+    threads{threads},
+    split_plies{split_plies},
+    queues(threads),
+    busy(threads, 0.0),
+    pending{0}
+    {}
+
+    // nodes per legal root move, in generation order
+    std::vector<unsigned long long> run(const position& p, int depth)
+    {
+        move_list moves;
+        generate(p, moves);
+
+        std::vector<std::atomic<unsigned long long>> nodes(moves.size());
+        root_nodes = &nodes;
+        busy.assign(threads, 0.0);
+
+        // seed the root moves over all queues
+        for(std::size_t i = 0; i < moves.size(); i++)
+        {
+            position child = p;
+            child.make_move(moves[i]);
+            push(i % threads, {child, depth - 1, 1, i});
+        }
+
+        std::vector<std::thread> workers;
+
+        for(int i = 0; i < threads; i++)
+        {
+            workers.emplace_back(&perft_pool::work, this, i);
+        }
+
+        for(std::thread& worker: workers)
+        {
+            worker.join();
+        }
+
+        return std::vector<unsigned long long>(nodes.begin(), nodes.end());
+    }
+
+    // fraction of the time threads spent running tasks
+    double efficiency(double time) const
+    {
+        double total = 0.0;
+        for(double b: busy) total += b;
+        return total / (threads * time);
+    }
+
+private:
+    struct task
+    {
+        position p;
+        int depth;
+        int ply;
+        std::size_t root;
+    };
+
+    struct queue
+    {
+        std::mutex mutex;
+        std::deque<task> tasks;
+    };
+
+    void push(int thread, task&& t)
+    {
+        pending++;
+        std::lock_guard<std::mutex> lock(queues[thread].mutex);
+        queues[thread].tasks.push_back(std::move(t));
+    }
+
+    bool pop(int thread, task& t)
+    {
+        std::lock_guard<std::mutex> lock(queues[thread].mutex);
+        if(queues[thread].tasks.empty()) return false;
+        t = std::move(queues[thread].tasks.back());
+        queues[thread].tasks.pop_back();
+        return true;
+    }
+
+    bool steal(int thread, task& t)
+    {
+        for(int i = 1; i < threads; i++)
+        {
+            queue& victim = queues[(thread + i) % threads];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if(victim.tasks.empty()) continue;
+            t = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    void work(int thread)
+    {
+        task t{position(), 0, 0, 0};
+
+        // children are pushed before their parent is done, so no work is left
+        // once nothing is pending
+        while(pending > 0)
+        {
+            if(!pop(thread, t) && !steal(thread, t))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            auto begin = std::chrono::steady_clock::now();
+
+            if(t.ply < split_plies && t.depth > 1)
+            {
+                move_list moves;
+                generate(t.p, moves);
+
+                for(const move& m: moves)
+                {
+                    position child = t.p;
+                    child.make_move(m);
+                    push(thread, {child, t.depth - 1, t.ply + 1, t.root});
+                }
+            }
+            else
+            {
+                (*root_nodes)[t.root] += perft(t.depth, t.p);
+            }
+
+            busy[thread] += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            pending--;
+        }
+
+        table.flush();
+    }
+
+    int threads;
+    int split_plies;
+    std::vector<queue> queues;
+    std::vector<double> busy;
+    std::atomic<long> pending;
+    std::vector<std::atomic<unsigned long long>>* root_nodes;
+};
+
+// Perft of a position, with divide output, on any number of threads.
+unsigned long long parallel_perft(int depth, position& p, int threads, double* efficiency = nullptr)
+{
+    if(threads <= 1 || depth <= 1)
+    {
+        if(efficiency) *efficiency = 1.0;
+        unsigned long long nodes = perft(depth, p, true);
+        table.flush();
+        return nodes;
+    }
+
+    move_list moves;
+    generate(p, moves);
+
+    perft_pool pool(threads);
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<unsigned long long> nodes = pool.run(p, depth);
+    std::chrono::duration<double> time = std::chrono::steady_clock::now() - begin;
+
+    if(efficiency) *efficiency = pool.efficiency(time.count());
+
+    unsigned long long total = 0;
+
+    for(std::size_t i = 0; i < moves.size(); i++)
+    {
+        std::cout << moves[i].to_lan() << ": " << nodes[i] << std::endl;
+        total += nodes[i];
+    }
+
+    return total;
+}
+
+int test(int depth = 5, bool attack_maps = false, int threads = 1)
 {
     for(auto& [test, result]: results)
     {
         std::cerr << "perft test '" << test << "': ";
 
-        position p = position::from_fen(result.fen);    
-        unsigned long long nodes = perft(depth, p, true);
+        position p = position::from_fen(result.fen);
+        p.set_attack_maps(attack_maps);
+        unsigned long long nodes = parallel_perft(depth, p, threads);
         unsigned long long answer = result.nodes[depth];
 
         if(nodes == answer)
@@ -95,34 +449,389 @@ int test(int depth = 5)
     return 0;
 }
 
+// Read a perft suite in EPD format.
+//
+// Each line is a position followed by its node counts, as in
+// "<fen> ;D1 20 ;D2 400". The move counters may be left out of the FEN.
+// Depths without a count have zero nodes.
+std::vector<result> read_suite(const std::string& path)
+{
+    std::ifstream file(path);
+
+    if(!file)
+    {
+        throw std::invalid_argument("can not open suite '" + path + "'");
+    }
+
+    std::vector<result> suite;
+    std::string line;
+
+    while(std::getline(file, line))
+    {
+        std::istringstream fields(line);
+        std::string fen;
+        std::getline(fields, fen, ';');
+
+        std::istringstream words(fen);
+        std::vector<std::string> parts;
+        for(std::string part; words >> part;) parts.push_back(part);
+
+        if(parts.empty() || parts.front().front() == '#') continue;
+
+        fen = parts[0];
+        for(std::size_t i = 1; i < parts.size(); i++) fen += " " + parts[i];
+        if(parts.size() == 4) fen += " 0 1";
+
+        result r{fen, {1}};
+
+        for(std::string field; std::getline(fields, field, ';');)
+        {
+            std::istringstream count(field);
+            std::string name;
+            unsigned long long nodes;
+
+            if(count >> name >> nodes && name.size() > 1 && name[0] == 'D')
+            {
+                std::size_t depth = std::stoul(name.substr(1));
+                if(r.nodes.size() <= depth) r.nodes.resize(depth + 1, 0);
+                r.nodes[depth] = nodes;
+            }
+        }
+
+        suite.push_back(r);
+    }
+
+    return suite;
+}
+
+// Run a perft suite.
+//
+// Every position is searched at its deepest counted depth that is not above
+// the given depth, with an empty hash table. Time and nodes per second of each
+// position are written as text, csv or json. Positions without a count at or
+// below the given depth are listed as skipped.
+int run_suite(const std::string& path, int max_depth, int threads, const std::string& format, counters* events)
+{
+    std::vector<result> suite = read_suite(path);
+
+    std::ostream& out = std::cout;
+    bool passed = true;
+    unsigned long long total_nodes = 0;
+    double total_time = 0.0;
+    int skipped = 0;
+
+    if(format == "csv")
+    {
+        out << "fen,depth,nodes,expected,passed,time,nps";
+        for(int e = 0; events && e < counters::events; e++) out << "," << counters::name(static_cast<counters::event>(e));
+        out << std::endl;
+    }
+    else if(format == "json")
+    {
+        out << "{\n  \"suite\": \"" << path << "\",\n  \"threads\": " << threads << ",\n  \"hash\": " << table.megabytes() << ",\n  \"positions\": [";
+    }
+
+    bool first = true;
+
+    for(const result& r: suite)
+    {
+        int depth = std::min(max_depth, static_cast<int>(r.nodes.size()) - 1);
+        while(depth > 0 && !r.nodes[depth]) depth--;
+
+        if(depth <= 0)
+        {
+            skipped++;
+
+            if(format == "csv")
+            {
+                out << r.fen << ",,,,skipped,,";
+                for(int e = 0; events && e < counters::events; e++) out << ",";
+                out << std::endl;
+            }
+            else if(format == "json")
+            {
+                out << (first ? "" : ",") << "\n    {\"fen\": \"" << r.fen << "\", \"skipped\": true}";
+            }
+            else
+            {
+                out << "skipped '" << r.fen << "': no count at depth " << max_depth << " or below" << std::endl;
+            }
+
+            first = false;
+            continue;
+        }
+
+        position p = position::from_fen(r.fen);
+        table.clear();
+
+        if(events) events->start();
+        auto begin = std::chrono::steady_clock::now();
+        unsigned long long nodes = 0;
+
+        if(threads <= 1)
+        {
+            nodes = perft(depth, p);
+        }
+        else
+        {
+            for(unsigned long long n: perft_pool(threads).run(p, depth)) nodes += n;
+        }
+
+        std::chrono::duration<double> time = std::chrono::steady_clock::now() - begin;
+        table.flush();
+
+        if(events) events->stop();
+
+        double nps = nodes / time.count();
+        bool success = nodes == r.nodes[depth];
+
+        passed &= success;
+        total_nodes += nodes;
+        total_time += time.count();
+
+        if(format == "csv")
+        {
+            out << r.fen << "," << depth << "," << nodes << "," << r.nodes[depth] << "," << success << "," << time.count() << "," << nps;
+
+            for(int e = 0; events && e < counters::events; e++)
+            {
+                out << ",";
+                if(events->has(static_cast<counters::event>(e))) out << events->get_run(static_cast<counters::event>(e));
+            }
+
+            out << std::endl;
+        }
+        else if(format == "json")
+        {
+            out << (first ? "" : ",") << "\n    {\"fen\": \"" << r.fen << "\", \"depth\": " << depth << ", \"nodes\": " << nodes
+                << ", \"expected\": " << r.nodes[depth] << ", \"passed\": " << (success ? "true" : "false")
+                << ", \"time\": " << time.count() << ", \"nps\": " << nps;
+
+            if(events)
+            {
+                out << ", \"counters\": {";
+                const char* separator = "";
+
+                for(int e = 0; e < counters::events; e++)
+                {
+                    if(!events->has(static_cast<counters::event>(e))) continue;
+
+                    out << separator << "\"" << counters::name(static_cast<counters::event>(e)) << "\": " << events->get_run(static_cast<counters::event>(e));
+                    separator = ", ";
+                }
+
+                out << "}";
+            }
+
+            out << "}";
+        }
+        else
+        {
+            out << (success ? "success" : "failure") << " '" << r.fen << "' depth " << depth << ": " << nodes << " (" << r.nodes[depth]
+                << " expected), " << time.count() << " s, " << nps << " nps" << std::endl;
+            if(events) events->report_run(out, nodes);
+        }
+
+        first = false;
+    }
+
+    double nps = total_time > 0.0 ? total_nodes / total_time : 0.0;
+
+    if(format == "json")
+    {
+        out << "\n  ],\n  \"nodes\": " << total_nodes << ",\n  \"time\": " << total_time << ",\n  \"nps\": " << nps
+            << ",\n  \"skipped\": " << skipped << ",\n  \"passed\": " << (passed ? "true" : "false") << "\n}" << std::endl;
+    }
+    else if(format != "csv")
+    {
+        out << "total: " << total_nodes << " nodes, " << total_time << " s, " << nps << " nps, " << skipped << " skipped" << std::endl;
+    }
+
+    // machine readable output is kept clean
+    if(events) events->report(format == "text" ? std::cout : std::cerr, total_nodes);
+
+    return passed ? 0 : 1;
+}
+
+static void usage(std::ostream& out, const char* program)
+{
+    out << "usage: " << program << " [options] [fen depth]" << std::endl
+        << "runs the perft tests when no position is given" << std::endl
+        << "options:" << std::endl
+        << "  --threads n     number of threads (default 1)" << std::endl
+        << "  --hash mb       size of the hash table, 0 disables it (default 64)" << std::endl
+        << "  --attack-maps   maintain attack maps" << std::endl
+        << "  --scaling       time the position with 1, 2, 4, ... threads" << std::endl
+        << "  --suite file    run an epd suite" << std::endl
+        << "  --depth n       maximum depth of the suite" << std::endl
+        << "  --format f      suite output, text, csv or json" << std::endl
+        << "  --counters      report hardware performance counters" << std::endl
+        << "  --help          show this message" << std::endl;
+}
+
 int main(int argc, char* argv[])
 {
     chess::init();
 
-    // run tests if no argument is supplied
-    if(argc == 1)
+    // options are prefixed with "--", the rest are positional arguments
+    std::vector<std::string> args;
+    bool attack_maps = false;
+    bool scaling = false;
+    int threads = 1;
+    int depth = 64;
+    std::size_t hash = 64;
+    std::string suite;
+    std::string format = "text";
+    std::optional<counters> events;
+
+    // options that take a value
+    const std::vector<std::string> valued{"--threads", "--hash", "--suite", "--depth", "--format"};
+
+    try
+    {
+        for(int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+
+            if(std::find(valued.begin(), valued.end(), arg) != valued.end() && i + 1 >= argc)
+            {
+                std::cerr << arg << " needs a value" << std::endl;
+                usage(std::cerr, argv[0]);
+                return 1;
+            }
+
+            if(arg == "--help")
+            {
+                usage(std::cout, argv[0]);
+                return 0;
+            }
+            else if(arg == "--attack-maps")
+            {
+                attack_maps = true;
+            }
+            else if(arg == "--threads")
+            {
+                threads = std::stoi(argv[++i]);
+            }
+            else if(arg == "--hash")
+            {
+                hash = std::stoul(argv[++i]);
+            }
+            else if(arg == "--suite")
+            {
+                suite = argv[++i];
+            }
+            else if(arg == "--depth")
+            {
+                depth = std::stoi(argv[++i]);
+            }
+            else if(arg == "--format")
+            {
+                format = argv[++i];
+            }
+            else if(arg == "--counters")
+            {
+                events.emplace();
+            }
+            else if(arg == "--scaling")
+            {
+                scaling = true;
+            }
+            else if(arg.starts_with("--"))
+            {
+                std::cerr << "unknown option " << arg << std::endl;
+                usage(std::cerr, argv[0]);
+                return 1;
+            }
+            else
+            {
+                args.push_back(arg);
+            }
+        }
+
+        if(args.size() == 2) depth = std::stoi(args[1]);
+    }
+    catch(const std::logic_error&)
+    {
+        // std::stoi and std::stoul throw on values that are not numbers
+        std::cerr << "invalid number" << std::endl;
+        usage(std::cerr, argv[0]);
+        return 1;
+    }
+
+    if(!args.empty() && args.size() != 2)
+    {
+        usage(std::cerr, argv[0]);
+        return 1;
+    }
+
+    table.resize(hash);
+
+    if(!suite.empty())
     {
-        return test();
+        return run_suite(suite, depth, threads, format, events ? &*events : nullptr);
+    }
+
+    // run tests if no position is supplied
+    if(args.empty())
+    {
+        return test(5, attack_maps, threads);
     }
 
     // otherwise run input position
-    std::string fen = argv[1];
-    int depth = std::stoi(argv[2]);
+    std::string fen = args[0];
 
     result answer = results.find(fen) != results.end() ? results.at(fen) : result{fen, {}};
     position p = position::from_fen(answer.fen);
+    p.set_attack_maps(attack_maps);
     
+    // time the run for every power of two number of threads up to the given
+    // number, speedup and efficiency are relative to one thread
+    if(scaling)
+    {
+        std::vector<int> counts;
+        for(int n = 1; n < threads; n *= 2) counts.push_back(n);
+        counts.push_back(threads);
+
+        double single = 0.0;
+
+        for(int n: counts)
+        {
+            table.clear();
+
+            auto begin = std::chrono::steady_clock::now();
+            perft_pool(n).run(p, depth);
+            std::chrono::duration<double> time = std::chrono::steady_clock::now() - begin;
+
+            if(n == 1) single = time.count();
+
+            std::cout << "threads: " << n << ", time: " << time.count() << " s, speedup: " << single / time.count()
+                      << ", efficiency: " << 100.0 * single / (n * time.count()) << " %" << std::endl;
+        }
+    }
+
+    table.clear();
+
+    double efficiency = 1.0;
+    if(events) events->start();
     auto begin = std::chrono::steady_clock::now();
-    unsigned long long nodes = perft(depth, p, true);
+    unsigned long long nodes = parallel_perft(depth, p, threads, &efficiency);
     auto end = std::chrono::steady_clock::now();
+    if(events) events->stop();
 
     std::chrono::duration<double> time = end - begin;
 
-    double nps = (1e9*nodes) / time.count();
+    double nps = nodes / time.count();
 
-    std::cout << "time: " << time.count() << " s (" << nps << " nps, " << table_hits << " hits)" << std::endl;
+    std::cout << "time: " << time.count() << " s (" << nps << " nps)" << std::endl;
+    std::cout << "hash: " << table.megabytes() << " MB (" << 100.0 * table.hit_rate() << " % hits, "
+              << 100.0 * table.occupancy() << " % full)" << std::endl;
+    std::cout << "threads: " << threads << " (" << 100.0 * efficiency << " % busy)" << std::endl;
     std::cout << "total: " << nodes << std::endl;
 
+    if(events) events->report(std::cout, nodes);
+    if(probes_enabled()) probe_report(std::cout);
+
     if(static_cast<unsigned>(depth) < answer.nodes.size())
     {
         std::cout << "expected: " << answer.nodes[depth] << std::endl;